@@ -0,0 +1,238 @@
+#include "adventure_solver.h"
+
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "object.h"
+#include "thread_pool.h"
+#include "tile.h"
+
+namespace {
+
+/// Block positions and where the player is, packed into 168 bits: rows of
+/// blocks 20 bits at a time, then the lowest cell of the player's region.
+using RoomState = std::array<uint64_t, 3>;
+
+struct RoomStateHash {
+  size_t operator()(RoomState const& state) const {
+    uint64_t hash = 0;
+    for (auto const word : state) {
+      hash = (hash ^ word) * 0x9E3779B97F4A7C15;
+      hash ^= hash >> 32;
+    }
+    return hash;
+  }
+};
+
+RoomState PackState(RoomBitboard const& blocks, RoomBitboard const& region) {
+  RoomState state{};
+  for (auto y = 0; y < kRoomHeight; ++y) {
+    auto const bit = y * kRoomWidth;
+    state[bit / 64] |= static_cast<uint64_t>(blocks[y]) << (bit % 64);
+    // Rows straddle words
+    if (bit % 64 + kRoomWidth > 64) {
+      state[bit / 64 + 1] |= static_cast<uint64_t>(blocks[y]) >>
+                             (64 - bit % 64);
+    }
+  }
+  for (auto cell = 0; cell < kRoomArea; ++cell) {
+    if ((region[cell / kRoomWidth] >> cell % kRoomWidth & 1) != 0) {
+      state[2] |= static_cast<uint64_t>(cell + 1) << 32;
+      break;
+    }
+  }
+  return state;
+}
+
+bool IsSet(RoomBitboard const& cells, int x, int y) {
+  return x >= 0 && x < kRoomWidth && y >= 0 && y < kRoomHeight &&
+         (cells[y] >> x & 1) != 0;
+}
+
+bool IsBlock(uint8_t object) { return object == 'g' || object == 'r'; }
+
+bool IsEmpty(RoomBitboard const& cells) {
+  return std::all_of(cells.begin(), cells.end(),
+                     [](uint32_t row) { return row == 0; });
+}
+
+uint8_t GetExistingExits(room_t const& room) {
+  uint8_t exits = 0;
+  for (auto exit = 0; exit < kNumRoomExits; ++exit) {
+    if (HasExit(room, static_cast<RoomExit>(exit))) {
+      exits |= 1 << exit;
+    }
+  }
+  return exits;
+}
+
+struct Node {
+  int room;
+  RoomExit entry;
+};
+
+/// Room the exit leads to and how the player comes into it, or -1.
+Node FollowExit(room_t const& room, RoomExit exit,
+                std::unordered_map<uint8_t, int> const& room_by_id) {
+  constexpr std::array<RoomExit, kNumRoomExits> kOpposite = {
+      kExitSouth, kExitWest, kExitNorth, kExitEast,
+      kExitDown,  kExitUp,   kExitTeleport};
+  std::array<uint8_t, kNumRoomExits> const destinations = {
+      room.nav.north, room.nav.east, room.nav.south,          room.nav.west,
+      room.nav.up,    room.nav.down, room.odd_design_room};
+  auto const found = room_by_id.find(destinations[exit]);
+  if (destinations[exit] == 0 || found == room_by_id.end()) {
+    return Node{-1, exit};
+  }
+  return Node{found->second, kOpposite[exit]};
+}
+
+}  // namespace
+
+uint8_t SearchRoomExits(room_t const& room, RoomExit entry,
+                        solver_options_t const& options, bool* incomplete) {
+  auto reach = options.reach;
+  reach.pass_blocks = true;
+  // Cells that are free once any block on them has moved
+  auto const open = GetWalkableCells(room, reach);
+
+  RoomBitboard blocks{};
+  for (auto y = 0; y < kRoomHeight; ++y) {
+    for (auto x = 0; x < kRoomWidth; ++x) {
+      if (IsBlock(room.objects[y * kRoomWidth + x])) {
+        blocks[y] |= 1u << x;
+      }
+    }
+  }
+
+  auto const walkable = [&](RoomBitboard const& block_cells) {
+    RoomBitboard cells;
+    for (auto y = 0; y < kRoomHeight; ++y) {
+      cells[y] = open[y] & ~block_cells[y];
+    }
+    return cells;
+  };
+
+  auto start = GetEntryCells(room, entry);
+  if (entry == kExitTeleport) {
+    start = walkable(blocks);
+  }
+  auto const region = FloodFill(start, walkable(blocks));
+  if (IsEmpty(region)) {
+    return 0;
+  }
+
+  auto const all_exits = GetExistingExits(room);
+  uint8_t exits = 0;
+  std::unordered_set<RoomState, RoomStateHash> seen;
+  std::vector<std::pair<RoomBitboard, RoomBitboard>> frontier = {
+      {blocks, region}};
+  seen.insert(PackState(blocks, region));
+
+  constexpr std::array<std::array<int, 2>, 4> kDirections = {
+      {{1, 0}, {-1, 0}, {0, 1}, {0, -1}}};
+  while (!frontier.empty() && exits != all_exits) {
+    auto const [current_blocks, current_region] = frontier.back();
+    frontier.pop_back();
+    exits |= GetReachableExits(room, current_region);
+    auto const free = walkable(current_blocks);
+
+    for (auto y = 0; y < kRoomHeight; ++y) {
+      for (auto x = 0; x < kRoomWidth; ++x) {
+        if (!IsSet(current_blocks, x, y)) {
+          continue;
+        }
+        for (auto const& [dx, dy] : kDirections) {
+          // Player behind the block, room in front of it
+          if (!IsSet(current_region, x - dx, y - dy) ||
+              !IsSet(free, x + dx, y + dy)) {
+            continue;
+          }
+          auto pushed = current_blocks;
+          pushed[y] &= ~(1u << x);
+          pushed[y + dy] |= 1u << (x + dx);
+          RoomBitboard player{};
+          player[y] = 1u << x;
+          auto const next_region = FloodFill(player, walkable(pushed));
+          if (!seen.insert(PackState(pushed, next_region)).second) {
+            continue;
+          }
+          if (seen.size() > options.max_states_per_room) {
+            *incomplete = true;
+            return exits;
+          }
+          frontier.emplace_back(pushed, next_region);
+        }
+      }
+    }
+  }
+  return exits;
+}
+
+adventure_reach_t SolveAdventure(std::vector<room_t> const& rooms,
+                                 int start_room,
+                                 solver_options_t const& options) {
+  std::unordered_map<uint8_t, int> room_by_id;
+  for (auto i = 0; i < rooms.size(); ++i) {
+    room_by_id.emplace(rooms[i].id, i);
+  }
+
+  adventure_reach_t result;
+  result.reachable.assign(rooms.size(), false);
+  result.previous.assign(rooms.size(), -1);
+  if (start_room < 0 || start_room >= rooms.size()) {
+    return result;
+  }
+
+  // Every (room, way in) is searched at most once
+  std::vector<uint8_t> entered(rooms.size(), 0);
+  auto const enter = [&](Node const& node, std::vector<Node>& frontier) {
+    if ((entered[node.room] >> node.entry & 1) != 0) {
+      return;
+    }
+    entered[node.room] |= 1 << node.entry;
+    frontier.push_back(node);
+  };
+
+  // The start room is searched from anywhere walkable
+  std::vector<Node> frontier;
+  enter(Node{start_room, kExitTeleport}, frontier);
+  result.reachable[start_room] = true;
+
+  while (!frontier.empty()) {
+    // Rooms in a frontier are independent, so search them in parallel
+    std::vector<uint8_t> exits(frontier.size());
+    std::vector<char> incomplete(frontier.size(), false);
+    ParallelFor(0, frontier.size(), 1, [&](size_t i) {
+      auto gave_up = false;
+      exits[i] = SearchRoomExits(rooms[frontier[i].room], frontier[i].entry,
+                                 options, &gave_up);
+      incomplete[i] = gave_up;
+    });
+
+    std::vector<Node> next;
+    for (auto i = 0; i < frontier.size(); ++i) {
+      result.incomplete |= incomplete[i] != 0;
+      auto const& room = rooms[frontier[i].room];
+      for (auto exit = 0; exit < kNumRoomExits; ++exit) {
+        if ((exits[i] >> exit & 1) == 0) {
+          continue;
+        }
+        auto const node =
+            FollowExit(room, static_cast<RoomExit>(exit), room_by_id);
+        if (node.room < 0) {
+          continue;
+        }
+        if (!result.reachable[node.room]) {
+          result.reachable[node.room] = true;
+          result.previous[node.room] = frontier[i].room;
+        }
+        enter(node, next);
+      }
+    }
+    frontier = std::move(next);
+  }
+  return result;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "room.h"
+#include "room_reach.h"
+
+struct solver_options_t {
+  /// `pass_blocks` is ignored: pushing blocks is part of the search
+  reach_options_t reach;
+  /// Block pushing can blow up, so each room search gives up after this many
+  /// states and reports the adventure as incomplete
+  size_t max_states_per_room = 1 << 16;
+};
+
+/// Exits reachable after coming in through `entry`, pushing movable blocks
+/// ('g', 'r') as needed. States are the block positions plus the region the
+/// player can walk around in, so walking never adds states. Sets
+/// `*incomplete` if the state limit was hit.
+uint8_t SearchRoomExits(room_t const& room, RoomExit entry,
+                        solver_options_t const& options, bool* incomplete);
+
+struct adventure_reach_t {
+  /// By index into the rooms
+  std::vector<bool> reachable;
+  /// Room the player first reached each room from, -1 for the start room and
+  /// unreachable rooms. Follow it back to get a route
+  std::vector<int> previous;
+  /// Some room searches gave up, so rooms marked unreachable might not be
+  bool incomplete = false;
+};
+
+/// Every room the player can get to from `start_room` (an index), following
+/// room_t::nav and odd design teleports.
+///
+/// Assumes rooms are reset when re-entered, so each (room, way in) pair is
+/// searched once. Doors and soft walls only ever open, so they're treated as
+/// already open (see `reach_options_t`) instead of being part of the state.
+/// Teleports may land anywhere walkable in their destination.
+adventure_reach_t SolveAdventure(std::vector<room_t> const& rooms,
+                                 int start_room,
+                                 solver_options_t const& options = {});
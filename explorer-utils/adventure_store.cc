@@ -0,0 +1,187 @@
+#include "adventure_store.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+#if defined(__SSE2__)
+
+constexpr auto kVectorSize = 16;
+// A byte counter wraps after this many additions
+constexpr auto kMaxVectorsPerBatch = 255;
+
+/// Rooms are a whole number of vectors so that each one can be checked
+/// without a scalar tail.
+static_assert(kRoomArea % kVectorSize == 0);
+
+size_t CountEqual(uint8_t const* data, size_t size, uint8_t value) {
+  auto const needle = _mm_set1_epi8(static_cast<char>(value));
+  auto const zero = _mm_setzero_si128();
+
+  size_t count = 0;
+  size_t i = 0;
+  while (size - i >= kVectorSize) {
+    // Each matching byte is -1, so subtracting counts up in every lane
+    auto counters = _mm_setzero_si128();
+    auto const vectors = std::min<size_t>((size - i) / kVectorSize,
+                                          kMaxVectorsPerBatch);
+    auto const end = i + vectors * kVectorSize;
+    for (; i < end; i += kVectorSize) {
+      auto const bytes =
+          _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + i));
+      counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(bytes, needle));
+    }
+    // Horizontal sum of the 16 lanes, as two 64-bit halves
+    auto const sums = _mm_sad_epu8(counters, zero);
+    count += _mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4);
+  }
+  for (; i < size; ++i) {
+    count += data[i] == value;
+  }
+  return count;
+}
+
+bool RoomContains(uint8_t const* cells, uint8_t value) {
+  auto const needle = _mm_set1_epi8(static_cast<char>(value));
+  auto found = _mm_setzero_si128();
+  for (auto i = 0; i < kRoomArea; i += kVectorSize) {
+    auto const bytes =
+        _mm_loadu_si128(reinterpret_cast<__m128i const*>(cells + i));
+    found = _mm_or_si128(found, _mm_cmpeq_epi8(bytes, needle));
+  }
+  return _mm_movemask_epi8(found) != 0;
+}
+
+void FindEqual(std::vector<uint8_t> const& column, uint8_t value,
+               std::vector<uint32_t>& indices) {
+  auto const needle = _mm_set1_epi8(static_cast<char>(value));
+  auto const size = column.size();
+  size_t i = 0;
+  for (; size - i >= kVectorSize; i += kVectorSize) {
+    auto const bytes =
+        _mm_loadu_si128(reinterpret_cast<__m128i const*>(column.data() + i));
+    auto mask = static_cast<unsigned>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, needle)));
+    while (mask != 0) {
+      indices.push_back(static_cast<uint32_t>(i + __builtin_ctz(mask)));
+      mask &= mask - 1;
+    }
+  }
+  for (; i < size; ++i) {
+    if (column[i] == value) {
+      indices.push_back(static_cast<uint32_t>(i));
+    }
+  }
+}
+
+#else
+
+size_t CountEqual(uint8_t const* data, size_t size, uint8_t value) {
+  return std::count(data, data + size, value);
+}
+
+bool RoomContains(uint8_t const* cells, uint8_t value) {
+  return std::find(cells, cells + kRoomArea, value) != cells + kRoomArea;
+}
+
+void FindEqual(std::vector<uint8_t> const& column, uint8_t value,
+               std::vector<uint32_t>& indices) {
+  for (size_t i = 0; i < column.size(); ++i) {
+    if (column[i] == value) {
+      indices.push_back(static_cast<uint32_t>(i));
+    }
+  }
+}
+
+#endif
+
+std::vector<uint32_t> FindRoomsContaining(std::vector<uint8_t> const& plane,
+                                          uint8_t value) {
+  std::vector<uint32_t> indices;
+  auto const num_rooms = plane.size() / kRoomArea;
+  for (size_t i = 0; i < num_rooms; ++i) {
+    if (RoomContains(plane.data() + i * kRoomArea, value)) {
+      indices.push_back(static_cast<uint32_t>(i));
+    }
+  }
+  return indices;
+}
+
+}  // namespace
+
+void AdventureStore::Add(room_t const& room) {
+  tiles.insert(tiles.end(), room.tiles.begin(), room.tiles.end());
+  objects.insert(objects.end(), room.objects.begin(), room.objects.end());
+  monster_ids.push_back(room.monster_id);
+  monster_counts.push_back(room.monster_count);
+  north.push_back(room.nav.north);
+  east.push_back(room.nav.east);
+  south.push_back(room.nav.south);
+  west.push_back(room.nav.west);
+  up.push_back(room.nav.up);
+  down.push_back(room.nav.down);
+  ids.push_back(room.id);
+  odd_design_rooms.push_back(room.odd_design_room);
+  names.push_back(room.name);
+}
+
+room_t AdventureStore::GetRoom(size_t index) const {
+  room_t room;
+  memcpy(room.tiles.data(), GetTiles(index), kRoomArea);
+  memcpy(room.objects.data(), GetObjects(index), kRoomArea);
+  room.monster_id = monster_ids[index];
+  room.monster_count = monster_counts[index];
+  room.nav.north = north[index];
+  room.nav.east = east[index];
+  room.nav.south = south[index];
+  room.nav.west = west[index];
+  room.nav.up = up[index];
+  room.nav.down = down[index];
+  room.id = ids[index];
+  room.odd_design_room = odd_design_rooms[index];
+  room.name = names[index];
+  return room;
+}
+
+size_t AdventureStore::CountTiles(uint8_t tile) const {
+  return CountEqual(tiles.data(), tiles.size(), tile);
+}
+
+size_t AdventureStore::CountObjects(uint8_t object) const {
+  return CountEqual(objects.data(), objects.size(), object);
+}
+
+std::vector<uint32_t> AdventureStore::FindRoomsWithTile(uint8_t tile) const {
+  return FindRoomsContaining(tiles, tile);
+}
+
+std::vector<uint32_t> AdventureStore::FindRoomsWithObject(
+    uint8_t object) const {
+  return FindRoomsContaining(objects, object);
+}
+
+std::vector<uint32_t> AdventureStore::FindRoomsWithMonster(
+    uint8_t monster_id) const {
+  std::vector<uint32_t> indices;
+  FindEqual(monster_ids, monster_id, indices);
+  return indices;
+}
+
+AdventureStore MakeAdventureStore(std::vector<room_t> const& rooms) {
+  AdventureStore store;
+  store.tiles.reserve(rooms.size() * kRoomArea);
+  store.objects.reserve(rooms.size() * kRoomArea);
+  for (auto const& room : rooms) {
+    store.Add(room);
+  }
+  return store;
+}
+
+AdventureStore LoadAdventureStore(std::string const& filename) {
+  return MakeAdventureStore(LoadRooms(filename));
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "room.h"
+
+/// Every room of an adventure, stored field by field so that scanning one
+/// field across the whole adventure only touches that field. Room `i` is
+/// `tiles[i * kRoomArea]` to `tiles[(i + 1) * kRoomArea - 1]`, and row `i` of
+/// every other column.
+struct AdventureStore {
+  std::vector<uint8_t> tiles;
+  std::vector<uint8_t> objects;
+  std::vector<uint8_t> monster_ids;
+  std::vector<uint8_t> monster_counts;
+  std::vector<uint8_t> north;
+  std::vector<uint8_t> east;
+  std::vector<uint8_t> south;
+  std::vector<uint8_t> west;
+  std::vector<uint8_t> up;
+  std::vector<uint8_t> down;
+  std::vector<uint8_t> ids;
+  std::vector<uint8_t> odd_design_rooms;
+  std::vector<std::string> names;
+
+  size_t size() const { return ids.size(); }
+
+  void Add(room_t const& room);
+  room_t GetRoom(size_t index) const;
+
+  uint8_t const* GetTiles(size_t index) const {
+    return tiles.data() + index * kRoomArea;
+  }
+  uint8_t const* GetObjects(size_t index) const {
+    return objects.data() + index * kRoomArea;
+  }
+
+  /// Number of cells, in every room, with this raw room_t::tiles value.
+  size_t CountTiles(uint8_t tile) const;
+  /// Number of cells, in every room, with this room_t::objects value.
+  size_t CountObjects(uint8_t object) const;
+
+  /// Indices of the rooms with at least one cell holding `tile`.
+  std::vector<uint32_t> FindRoomsWithTile(uint8_t tile) const;
+  /// Indices of the rooms with at least one cell holding `object`.
+  std::vector<uint32_t> FindRoomsWithObject(uint8_t object) const;
+  /// Indices of the rooms whose room_t::monster_id is `monster_id`.
+  std::vector<uint32_t> FindRoomsWithMonster(uint8_t monster_id) const;
+};
+
+AdventureStore MakeAdventureStore(std::vector<room_t> const& rooms);
+AdventureStore LoadAdventureStore(std::string const& filename);
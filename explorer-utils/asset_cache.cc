@@ -0,0 +1,276 @@
+#include "asset_cache.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "stats.h"
+
+namespace {
+
+constexpr auto kMagic = std::array<char, 8>{'E', 'X', 'P', 'L', 'C', 'A', 'C',
+                                            'H'};
+// Reads back differently on a machine with the other byte order
+constexpr uint32_t kByteOrderMark = 0x01020304;
+
+enum SectionKind : uint32_t {
+  kSectionSprites = 1,
+  kSectionMonsterData = 2,
+  kSectionRooms = 3,
+};
+
+struct FileHeader {
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t byte_order_mark;
+  uint64_t file_size;
+  uint32_t section_count;
+  uint32_t reserved;
+};
+
+struct SectionHeader {
+  uint32_t kind;
+  uint32_t count;
+  uint64_t source_hash;
+  // From the start of the file
+  uint64_t offset;
+  // In bytes
+  uint64_t size;
+  // Sprites only; sprite_stride is in pixels
+  uint32_t width;
+  uint32_t height;
+  uint64_t sprite_stride;
+};
+
+// Everything in a room_t, in declaration order. The name is stored like in
+// the RMS file: a length byte followed by a fixed-size buffer.
+constexpr auto kRoomSize = kRoomArea * 2 + 10 + 1 + kRoomNameMaxLength;
+
+size_t AlignUp(size_t offset) {
+  return (offset + kSpriteArenaAlignment - 1) / kSpriteArenaAlignment *
+         kSpriteArenaAlignment;
+}
+
+/// `a` * `b`, or false if that doesn't fit in 64 bits.
+bool MultiplyChecked(uint64_t a, uint64_t b, uint64_t* product) {
+  if (a != 0 && b > UINT64_MAX / a) {
+    return false;
+  }
+  *product = a * b;
+  return true;
+}
+
+/// Only called on files that `AssetCache::Open` has validated.
+SectionHeader const* FindSection(MappedFile const& file, uint32_t kind,
+                                 uint64_t source_hash) {
+  FileHeader header;
+  memcpy(&header, file.data(), sizeof(header));
+  auto const* const table =
+      reinterpret_cast<SectionHeader const*>(file.data() + sizeof(header));
+  for (auto i = 0; i < header.section_count; ++i) {
+    if (table[i].kind == kind && table[i].source_hash == source_hash) {
+      return &table[i];
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+uint64_t HashSourceFile(std::string const& filename) {
+  MappedFile const file(filename);
+  return HashBytes(file.data(), file.size());
+}
+
+void AssetCacheWriter::AddSprites(uint64_t source_hash,
+                                  SpriteArenaView const& sprites) {
+  auto const* const bytes = reinterpret_cast<uint8_t const*>(sprites.GetData());
+  auto const size =
+      sprites.size() * sprites.GetSpriteStride() * sizeof(color_t);
+  sections_.push_back(Section{
+      kSectionSprites, static_cast<uint32_t>(sprites.size()), source_hash,
+      static_cast<uint32_t>(sprites.GetWidth()),
+      static_cast<uint32_t>(sprites.GetHeight()), sprites.GetSpriteStride(),
+      std::vector<uint8_t>(bytes, bytes + size)});
+}
+
+void AssetCacheWriter::AddMonsterData(uint64_t source_hash,
+                                      std::vector<monster_t> const& monsters) {
+  std::vector<uint8_t> payload;
+  for (auto const& monster : monsters) {
+    payload.push_back(monster.gfx);
+  }
+  sections_.push_back(Section{kSectionMonsterData,
+                              static_cast<uint32_t>(monsters.size()),
+                              source_hash, 0, 0, 0, std::move(payload)});
+}
+
+void AssetCacheWriter::AddRooms(uint64_t source_hash,
+                                std::vector<room_t> const& rooms) {
+  std::vector<uint8_t> payload;
+  payload.reserve(rooms.size() * kRoomSize);
+  for (auto const& room : rooms) {
+    payload.insert(payload.end(), room.tiles.begin(), room.tiles.end());
+    payload.insert(payload.end(), room.objects.begin(), room.objects.end());
+    payload.insert(payload.end(),
+                   {room.monster_id, room.monster_count, room.nav.north,
+                    room.nav.east, room.nav.south, room.nav.west, room.nav.up,
+                    room.nav.down, room.id, room.odd_design_room});
+    auto const name_length =
+        std::min<size_t>(room.name.size(), kRoomNameMaxLength);
+    payload.push_back(static_cast<uint8_t>(name_length));
+    payload.insert(payload.end(), room.name.begin(),
+                   room.name.begin() + name_length);
+    payload.insert(payload.end(), kRoomNameMaxLength - name_length, 0);
+  }
+  sections_.push_back(Section{kSectionRooms,
+                              static_cast<uint32_t>(rooms.size()), source_hash,
+                              0, 0, 0, std::move(payload)});
+}
+
+void AssetCacheWriter::Write(std::string const& filename) const {
+  STATS_TIMER("write cache");
+  std::vector<SectionHeader> table;
+  auto offset =
+      AlignUp(sizeof(FileHeader) +
+              sections_.size() * sizeof(SectionHeader));
+  for (auto const& section : sections_) {
+    table.push_back(SectionHeader{
+        section.kind, section.count, section.source_hash, offset,
+        section.payload.size(), section.width, section.height,
+        section.sprite_stride});
+    offset = AlignUp(offset + section.payload.size());
+  }
+
+  FileHeader header{};
+  header.magic = kMagic;
+  header.version = kAssetCacheVersion;
+  header.byte_order_mark = kByteOrderMark;
+  header.file_size = offset;
+  header.section_count = static_cast<uint32_t>(sections_.size());
+
+  std::vector<uint8_t> out(offset, 0);
+  memcpy(out.data(), &header, sizeof(header));
+  memcpy(out.data() + sizeof(header), table.data(),
+         table.size() * sizeof(table[0]));
+  for (auto i = 0; i < sections_.size(); ++i) {
+    memcpy(out.data() + table[i].offset, sections_[i].payload.data(),
+           sections_[i].payload.size());
+  }
+
+  ReplaceFile(filename, out.data(), out.size());
+}
+
+AssetCache::AssetCache(std::unique_ptr<MappedFile> file)
+    : file_(std::move(file)) {}
+
+std::unique_ptr<AssetCache> AssetCache::Open(std::string const& filename) {
+  STATS_TIMER("open cache");
+  std::unique_ptr<MappedFile> file;
+  try {
+    file = std::make_unique<MappedFile>(filename);
+  } catch (std::runtime_error const&) {
+    return nullptr;
+  }
+
+  if (file->size() < sizeof(FileHeader)) {
+    return nullptr;
+  }
+  FileHeader header;
+  memcpy(&header, file->data(), sizeof(header));
+  if (header.magic != kMagic || header.version != kAssetCacheVersion ||
+      header.byte_order_mark != kByteOrderMark ||
+      header.file_size != file->size()) {
+    return nullptr;
+  }
+
+  auto const table_end =
+      sizeof(FileHeader) + header.section_count * sizeof(SectionHeader);
+  if (table_end > file->size()) {
+    return nullptr;
+  }
+  auto const* const table =
+      reinterpret_cast<SectionHeader const*>(file->data() + sizeof(header));
+  for (auto i = 0; i < header.section_count; ++i) {
+    auto const& section = table[i];
+    if (section.offset % kSpriteArenaAlignment != 0 ||
+        section.offset < table_end || section.offset > file->size() ||
+        section.size > file->size() - section.offset) {
+      return nullptr;
+    }
+  }
+
+  return std::unique_ptr<AssetCache>(new AssetCache(std::move(file)));
+}
+
+std::optional<SpriteArenaView> AssetCache::FindSprites(
+    uint64_t source_hash) const {
+  auto const* const section =
+      FindSection(*file_, kSectionSprites, source_hash);
+  if (section == nullptr) {
+    return std::nullopt;
+  }
+  // Corrupt (or crafted) sizes mustn't wrap around into a view that reads
+  // past the end of the mapping
+  uint64_t sprite_area = 0;
+  uint64_t num_pixels = 0;
+  uint64_t size = 0;
+  if (!MultiplyChecked(section->width, section->height, &sprite_area) ||
+      section->sprite_stride < sprite_area ||
+      !MultiplyChecked(section->count, section->sprite_stride, &num_pixels) ||
+      !MultiplyChecked(num_pixels, sizeof(color_t), &size) ||
+      section->size != size || section->offset > file_->size() ||
+      size > file_->size() - section->offset) {
+    return std::nullopt;
+  }
+  return SpriteArenaView(
+      reinterpret_cast<color_t const*>(file_->data() + section->offset),
+      section->count, section->width, section->height, section->sprite_stride);
+}
+
+std::optional<std::vector<monster_t>> AssetCache::FindMonsterData(
+    uint64_t source_hash) const {
+  auto const* const section =
+      FindSection(*file_, kSectionMonsterData, source_hash);
+  if (section == nullptr || section->size != section->count) {
+    return std::nullopt;
+  }
+  std::vector<monster_t> monsters;
+  auto const* const payload = file_->data() + section->offset;
+  for (auto i = 0; i < section->count; ++i) {
+    monsters.push_back(monster_t{payload[i]});
+  }
+  return monsters;
+}
+
+std::optional<std::vector<room_t>> AssetCache::FindRooms(
+    uint64_t source_hash) const {
+  auto const* const section =
+      FindSection(*file_, kSectionRooms, source_hash);
+  if (section == nullptr || section->size != section->count * kRoomSize) {
+    return std::nullopt;
+  }
+  std::vector<room_t> rooms(section->count);
+  auto const* payload = file_->data() + section->offset;
+  for (auto& room : rooms) {
+    memcpy(room.tiles.data(), payload, kRoomArea);
+    memcpy(room.objects.data(), payload + kRoomArea, kRoomArea);
+    payload += kRoomArea * 2;
+    room.monster_id = *payload++;
+    room.monster_count = *payload++;
+    room.nav.north = *payload++;
+    room.nav.east = *payload++;
+    room.nav.south = *payload++;
+    room.nav.west = *payload++;
+    room.nav.up = *payload++;
+    room.nav.down = *payload++;
+    room.id = *payload++;
+    room.odd_design_room = *payload++;
+    auto const name_length = std::min<int>(*payload, kRoomNameMaxLength);
+    room.name.assign(reinterpret_cast<char const*>(payload + 1), name_length);
+    payload += 1 + kRoomNameMaxLength;
+  }
+  return rooms;
+}
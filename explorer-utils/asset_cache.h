@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "file.h"
+#include "monster.h"
+#include "room.h"
+#include "sprite_arena.h"
+
+/// Bumped whenever the on-disk layout changes. Caches with another version are
+/// rejected on open.
+constexpr uint32_t kAssetCacheVersion = 3;
+
+/// Identifies a source file by its contents so that a stale cache entry is
+/// never used after the file is modified.
+uint64_t HashSourceFile(std::string const& filename);
+
+/// Collects decoded assets and writes them out as a cache file.
+///
+/// Layout: a fixed header, a table of sections, then each section's payload
+/// starting on a `kSpriteArenaAlignment` boundary. Sprite payloads are the
+/// raw `SpriteArena` buffer so they can be used straight out of the mapping.
+/// Values are stored in native byte order.
+class AssetCacheWriter {
+ public:
+  void AddSprites(uint64_t source_hash, SpriteArenaView const& sprites);
+  void AddMonsterData(uint64_t source_hash,
+                      std::vector<monster_t> const& monsters);
+  void AddRooms(uint64_t source_hash, std::vector<room_t> const& rooms);
+
+  /// Replaces `filename` in one go (see `ReplaceFile`), so other processes
+  /// using the old cache are unaffected. Throws std::runtime_error on I/O
+  /// failure.
+  void Write(std::string const& filename) const;
+
+ private:
+  struct Section {
+    uint32_t kind;
+    uint32_t count;
+    uint64_t source_hash;
+    uint32_t width;
+    uint32_t height;
+    uint64_t sprite_stride;
+    std::vector<uint8_t> payload;
+  };
+
+  std::vector<Section> sections_;
+};
+
+/// Memory-mapped cache written by `AssetCacheWriter`. Lookups are by source
+/// hash; a miss means the caller has to decode the source itself.
+class AssetCache {
+ public:
+  /// Returns null if the file doesn't exist, has a different version, or is
+  /// malformed. Only the header and section table are checked, so this is
+  /// cheap regardless of the size of the cache.
+  static std::unique_ptr<AssetCache> Open(std::string const& filename);
+
+  /// The returned view points into the mapping and is valid for the lifetime
+  /// of this object.
+  std::optional<SpriteArenaView> FindSprites(uint64_t source_hash) const;
+  std::optional<std::vector<monster_t>> FindMonsterData(
+      uint64_t source_hash) const;
+  std::optional<std::vector<room_t>> FindRooms(uint64_t source_hash) const;
+
+ private:
+  explicit AssetCache(std::unique_ptr<MappedFile> file);
+
+  std::unique_ptr<MappedFile> file_;
+};
@@ -0,0 +1,25 @@
+#include "diagnostic.h"
+
+#include <stdexcept>
+
+#include "file.h"
+
+std::string FormatDiagnostic(diagnostic_t const& diagnostic) {
+  auto text = diagnostic.file + ':' + std::to_string(diagnostic.offset) + ": ";
+  if (diagnostic.record >= 0) {
+    text += "record " + std::to_string(diagnostic.record) + ": ";
+  }
+  return text + diagnostic.field + ": " + diagnostic.message;
+}
+
+bool ReadInputFile(std::string const& file, std::vector<uint8_t>& data,
+                   Diagnostics& diagnostics) {
+  try {
+    data = ReadBinaryFile(file);
+    return true;
+  } catch (std::runtime_error const& error) {
+    data.clear();
+    diagnostics.push_back({file, -1, 0, "file", error.what(), true});
+    return false;
+  }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// One problem found by a validating loader. Validation happens while the file
+/// is decoded, so asking for diagnostics costs no extra pass over the data.
+struct diagnostic_t {
+  std::string file;
+  // Record (sprite cell, monster or room) the problem is in, or -1 if it's
+  // about the file as a whole
+  int record = -1;
+  // Byte offset of `field` from the start of the file
+  size_t offset = 0;
+  std::string field;
+  std::string message;
+  // The file as a whole can't be used: unreadable, the wrong format or cut
+  // short. Anything else only affects the record it's about.
+  bool fatal = false;
+};
+
+using Diagnostics = std::vector<diagnostic_t>;
+
+/// "file:offset: record N: field: message", like a compiler error.
+std::string FormatDiagnostic(diagnostic_t const& diagnostic);
+
+/// Reads `file` for a validating loader. A file that can't be read is reported
+/// in `diagnostics` as fatal (and results in empty `data`) instead of
+/// throwing.
+bool ReadInputFile(std::string const& file, std::vector<uint8_t>& data,
+                   Diagnostics& diagnostics);
@@ -1,17 +1,114 @@
 #include "file.h"
 
+#include <cstdio>
 #include <fstream>
 #include <iterator>
 #include <stdexcept>
 
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "stats.h"
+
 using namespace std::string_literals;
 
 std::vector<uint8_t> ReadBinaryFile(std::string const& file) {
+  STATS_TIMER("read file");
   std::ifstream in(file, std::ios_base::binary);
   if (!in.good()) {
     throw std::runtime_error("Failed to open file: "s + file);
   }
 
-  return std::vector<uint8_t>(std::istreambuf_iterator<char>(in),
-                              std::istreambuf_iterator<char>());
+  std::vector<uint8_t> data(std::istreambuf_iterator<char>(in),
+                            std::istreambuf_iterator<char>{});
+  STATS_COUNT(kStatBytesRead, data.size());
+  return data;
+}
+
+void ReplaceFile(std::string const& file, uint8_t const* data, size_t size) {
+  // Named after the process so that concurrent writers never share one
+#ifdef _WIN32
+  auto const temp_file = file + "." + std::to_string(_getpid()) + ".tmp";
+#else
+  auto const temp_file = file + "." + std::to_string(getpid()) + ".tmp";
+#endif
+  {
+    std::ofstream out(temp_file, std::ios_base::binary);
+    out.write(reinterpret_cast<char const*>(data), size);
+    out.close();
+    if (!out.good()) {
+      std::remove(temp_file.c_str());
+      throw std::runtime_error("Failed to write file: "s + temp_file);
+    }
+  }
+#ifdef _WIN32
+  // Windows won't rename over an existing file. Nothing there keeps it
+  // mapped (see MappedFile), so it can go first.
+  std::remove(file.c_str());
+#endif
+  if (std::rename(temp_file.c_str(), file.c_str()) != 0) {
+    std::remove(temp_file.c_str());
+    throw std::runtime_error("Failed to replace file: "s + file);
+  }
+}
+
+uint64_t HashBytes(uint8_t const* data, size_t size) {
+  auto hash = uint64_t{0xcbf29ce484222325};
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= data[i];
+    hash *= uint64_t{0x100000001b3};
+  }
+  return hash;
+}
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(std::string const& file)
+    : fallback_(ReadBinaryFile(file)) {
+  data_ = fallback_.data();
+  size_ = fallback_.size();
+}
+
+MappedFile::~MappedFile() = default;
+
+#else
+
+MappedFile::MappedFile(std::string const& file) {
+  auto const fd = open(file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open file: "s + file);
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error("Failed to stat file: "s + file);
+  }
+  size_ = static_cast<size_t>(st.st_size);
+
+  // mmap doesn't allow empty mappings; an empty file is just no data
+  if (size_ != 0) {
+    auto* const mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("Failed to map file: "s + file);
+    }
+    data_ = static_cast<uint8_t const*>(mapping);
+  }
+  close(fd);
+  STATS_COUNT(kStatBytesRead, size_);
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    munmap(const_cast<uint8_t*>(data_), size_);
+  }
 }
+
+#endif
@@ -1,7 +1,36 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
 
 std::vector<uint8_t> ReadBinaryFile(std::string const& file);
+
+/// Writes `size` bytes to a temporary file next to `file` and renames it over
+/// `file`, so that whoever has the old file mapped keeps seeing all of it and
+/// a crash never leaves it half written. Throws std::runtime_error on failure.
+void ReplaceFile(std::string const& file, uint8_t const* data, size_t size);
+
+/// 64-bit FNV-1a hash, used to fingerprint file contents.
+uint64_t HashBytes(uint8_t const* data, size_t size);
+
+/// Read-only view of a whole file. On POSIX systems the file is memory-mapped;
+/// elsewhere it is read into memory.
+class MappedFile {
+ public:
+  /// Throws std::runtime_error if the file can't be opened.
+  explicit MappedFile(std::string const& file);
+  ~MappedFile();
+
+  MappedFile(MappedFile const&) = delete;
+  MappedFile& operator=(MappedFile const&) = delete;
+
+  uint8_t const* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  uint8_t const* data_ = nullptr;
+  size_t size_ = 0;
+  std::vector<uint8_t> fallback_;
+};
@@ -0,0 +1,297 @@
+#include "file_writer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#ifdef EXPLORER_UTILS_IO_URING
+#include <errno.h>
+#include <fcntl.h>
+#include <liburing.h>
+#include <unistd.h>
+#endif
+
+#include "stats.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+// Files taken off the queue at once, and the size of the io_uring queues
+constexpr size_t kMaxBatchSize = 64;
+
+/// Sets `failed[i]` for every file of `batch` that couldn't be written.
+void WriteFiles(std::vector<queued_file_t> const& batch,
+                std::vector<char>& failed) {
+  for (size_t i = 0; i < batch.size(); ++i) {
+    std::ofstream out(batch[i].filename, std::ios_base::binary);
+    out.write(batch[i].data.data(), batch[i].data.size());
+    out.flush();
+    failed[i] = !out.good();
+  }
+}
+
+#ifdef EXPLORER_UTILS_IO_URING
+// Writes are submitted in chunks no bigger than this, since the length of an
+// io_uring write is 32 bits
+constexpr size_t kMaxUringWrite = 1 << 30;
+
+/// Writes `size` bytes at `offset` with plain system calls.
+bool WriteAll(int fd, char const* data, size_t size, off_t offset) {
+  while (size > 0) {
+    auto const written = pwrite(fd, data, size, offset);
+    if (written < 0) {
+      return false;
+    }
+    data += written;
+    size -= written;
+    offset += written;
+  }
+  return true;
+}
+
+/// Submits the writes of a whole batch with a single system call. Opening and
+/// closing files stays synchronous: it's cheap next to the writes, and doing
+/// them through the ring too needs a much newer kernel.
+class UringBatchWriter {
+ public:
+  UringBatchWriter() {
+    open_ = io_uring_queue_init(kMaxBatchSize, &ring_, 0) == 0;
+    ready_ = open_;
+  }
+
+  ~UringBatchWriter() {
+    // Give writes abandoned by a failed wait a last chance to finish, since
+    // their data is freed once the ring is gone
+    for (; num_abandoned_ > 0; --num_abandoned_) {
+      io_uring_cqe* cqe = nullptr;
+      if (WaitForCompletion(cqe) < 0) {
+        break;
+      }
+      io_uring_cqe_seen(&ring_, cqe);
+    }
+    if (open_) {
+      io_uring_queue_exit(&ring_);
+    }
+  }
+
+  UringBatchWriter(UringBatchWriter const&) = delete;
+  UringBatchWriter& operator=(UringBatchWriter const&) = delete;
+
+  /// False if the kernel doesn't support io_uring (or it's been disabled), or
+  /// once the ring has failed.
+  bool IsReady() const { return ready_; }
+
+  /// Same contract as `WriteFiles`. `batch` must be no bigger than
+  /// kMaxBatchSize. Files that were never submitted are written with plain
+  /// system calls instead. If waiting for the ring fails, every file not yet
+  /// written fails. The kernel may still read their data, so it's kept until
+  /// the ring is gone and `batch` is left with just the filenames.
+  void Write(std::vector<queued_file_t>& batch, std::vector<char>& failed) {
+    std::vector<int> fds(batch.size(), -1);
+    std::vector<char> pending(batch.size(), false);
+    auto num_queued = 0;
+    for (size_t i = 0; i < batch.size(); ++i) {
+      fds[i] = open(batch[i].filename.c_str(),
+                    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+      if (fds[i] < 0) {
+        failed[i] = true;
+        continue;
+      }
+      auto const size = std::min(batch[i].data.size(), kMaxUringWrite);
+      auto* const sqe = io_uring_get_sqe(&ring_);
+      io_uring_prep_write(sqe, fds[i], batch[i].data.data(),
+                          static_cast<unsigned>(size), 0);
+      sqe->user_data = i;
+      pending[i] = true;
+      ++num_queued;
+    }
+
+    // The kernel only waits if everything was submitted, so only wait for
+    // what was. Whatever wasn't is stuck in the ring and would be submitted
+    // along with the next batch, after its file has been closed, so the ring
+    // isn't used again.
+    auto const num_submitted = std::max(
+        num_queued > 0 ? io_uring_submit_and_wait(&ring_, num_queued) : 0, 0);
+    for (auto n = 0; n < num_submitted; ++n) {
+      io_uring_cqe* cqe = nullptr;
+      if (WaitForCompletion(cqe) < 0) {
+        Abandon(batch, pending, failed, num_submitted - n);
+        break;
+      }
+      auto const i = static_cast<size_t>(cqe->user_data);
+      auto const written = cqe->res;
+      io_uring_cqe_seen(&ring_, cqe);
+      pending[i] = false;
+
+      // Finish off short writes (and anything over kMaxUringWrite) directly
+      auto const& data = batch[i].data;
+      failed[i] = written < 0 ||
+                  !WriteAll(fds[i], data.data() + written,
+                            data.size() - written, written);
+    }
+    if (num_submitted < num_queued && num_abandoned_ == 0) {
+      Shutdown();
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+      if (pending[i]) {
+        failed[i] = !WriteAll(fds[i], batch[i].data.data(),
+                              batch[i].data.size(), 0);
+      }
+      if (fds[i] >= 0 && close(fds[i]) != 0) {
+        failed[i] = true;
+      }
+    }
+  }
+
+ private:
+  /// Retries waits interrupted by a signal.
+  int WaitForCompletion(io_uring_cqe*& cqe) {
+    auto result = io_uring_wait_cqe(&ring_, &cqe);
+    while (result == -EINTR) {
+      result = io_uring_wait_cqe(&ring_, &cqe);
+    }
+    return result;
+  }
+
+  /// Drops anything left unsubmitted. Only safe once nothing is in flight.
+  void Shutdown() {
+    if (open_) {
+      io_uring_queue_exit(&ring_);
+      open_ = false;
+      ready_ = false;
+    }
+  }
+
+  /// Gives up on the `num_in_flight` writes of `batch` still pending, without
+  /// freeing or rewriting their data. The ring stays open but unused.
+  void Abandon(std::vector<queued_file_t>& batch, std::vector<char>& pending,
+               std::vector<char>& failed, int num_in_flight) {
+    std::vector<queued_file_t> filenames(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+      filenames[i].filename = batch[i].filename;
+      failed[i] = failed[i] || pending[i];
+      pending[i] = false;
+    }
+    // Moving the vector keeps every string where it is, short ones included
+    abandoned_.push_back(std::move(batch));
+    batch = std::move(filenames);
+    num_abandoned_ += num_in_flight;
+    ready_ = false;
+  }
+
+  io_uring ring_;
+  bool open_ = false;
+  // Usable for new batches: open and never failed
+  bool ready_ = false;
+  std::vector<std::vector<queued_file_t>> abandoned_;
+  int num_abandoned_ = 0;
+};
+#endif
+
+}  // namespace
+
+AsyncFileWriter::AsyncFileWriter(size_t max_queued_bytes)
+    : max_queued_bytes_(max_queued_bytes) {
+  thread_ = std::thread([this] { Run(); });
+}
+
+AsyncFileWriter::~AsyncFileWriter() { Stop(); }
+
+void AsyncFileWriter::Write(std::string filename, std::string data) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (stopping_) {
+    throw std::logic_error("AsyncFileWriter::Write called after Finish");
+  }
+  // A file bigger than the limit still goes through, once it's on its own
+  written_.wait(lock, [this, &data] {
+    return queued_bytes_ == 0 ||
+           queued_bytes_ + data.size() <= max_queued_bytes_;
+  });
+  queued_bytes_ += data.size();
+  queue_.push_back({std::move(filename), std::move(data)});
+  lock.unlock();
+  queued_.notify_one();
+}
+
+void AsyncFileWriter::Finish() {
+  Stop();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!error_.empty()) {
+    throw std::runtime_error(error_);
+  }
+}
+
+void AsyncFileWriter::Run() {
+#ifdef EXPLORER_UTILS_IO_URING
+  UringBatchWriter uring;
+#endif
+
+  std::vector<queued_file_t> batch;
+  while (true) {
+    batch.clear();
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      queued_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      while (!queue_.empty() && batch.size() < kMaxBatchSize) {
+        batch.push_back(std::move(queue_.front()));
+        queue_.pop_front();
+      }
+    }
+
+    // Taken first, since UringBatchWriter may have to hold on to the data
+    std::vector<size_t> sizes;
+    for (auto const& file : batch) {
+      sizes.push_back(file.data.size());
+    }
+
+    std::vector<char> failed(batch.size(), false);
+    {
+      STATS_TIMER("write files");
+#ifdef EXPLORER_UTILS_IO_URING
+      if (uring.IsReady()) {
+        uring.Write(batch, failed);
+      } else {
+        WriteFiles(batch, failed);
+      }
+#else
+      WriteFiles(batch, failed);
+#endif
+    }
+
+    size_t bytes = 0;
+    std::string error;
+    for (size_t i = 0; i < batch.size(); ++i) {
+      bytes += sizes[i];
+      if (failed[i] && error.empty()) {
+        error = "Failed to write file: "s + batch[i].filename;
+      } else if (!failed[i]) {
+        STATS_COUNT(kStatBytesWritten, sizes[i]);
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queued_bytes_ -= bytes;
+      if (error_.empty()) {
+        error_ = std::move(error);
+      }
+    }
+    written_.notify_all();
+  }
+}
+
+void AsyncFileWriter::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  queued_.notify_one();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// A file waiting to be written by an `AsyncFileWriter`.
+struct queued_file_t {
+  std::string filename;
+  std::string data;
+};
+
+/// Writes whole files on a thread of its own, so that whatever produces them
+/// (e.g. images encoded on the thread pool) never waits for the disk. Files
+/// are taken off the queue in batches; with -DEXPLORER_UTILS_IO_URING=ON on
+/// Linux, each batch is submitted to the kernel through io_uring at once.
+class AsyncFileWriter {
+ public:
+  static constexpr size_t kDefaultMaxQueuedBytes = 64 << 20;
+
+  /// `Write` blocks while more than `max_queued_bytes` of files are waiting
+  /// to be written, so memory stays bounded however fast they're produced.
+  explicit AsyncFileWriter(size_t max_queued_bytes = kDefaultMaxQueuedBytes);
+  /// Writes whatever is still queued, ignoring errors. Call `Finish` to see
+  /// them.
+  ~AsyncFileWriter();
+
+  AsyncFileWriter(AsyncFileWriter const&) = delete;
+  AsyncFileWriter& operator=(AsyncFileWriter const&) = delete;
+
+  /// Queues `data` to be written to `filename`, replacing any existing file.
+  /// Safe to call from any number of threads.
+  void Write(std::string filename, std::string data);
+
+  /// Returns once every queued file has been written. Throws
+  /// std::runtime_error naming the first file that couldn't be written. No
+  /// more files can be written afterwards.
+  void Finish();
+
+ private:
+  void Run();
+  void Stop();
+
+  size_t const max_queued_bytes_;
+  std::mutex mutex_;
+  std::condition_variable queued_;
+  std::condition_variable written_;
+  std::deque<queued_file_t> queue_;
+  // Includes the batch being written
+  size_t queued_bytes_ = 0;
+  bool stopping_ = false;
+  std::string error_;
+  std::thread thread_;
+};
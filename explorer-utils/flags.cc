@@ -0,0 +1,65 @@
+#include "flags.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+[[noreturn]] void ExitWithUsageError(std::string const& message) {
+  std::cerr << message << '\n';
+  std::exit(1);
+}
+
+}  // namespace
+
+Flags::Flags(int argc, char** argv, std::set<std::string> const& switches) {
+  for (auto i = 1; i < argc; ++i) {
+    std::string const arg = argv[i];
+    if (arg.size() <= 2 || arg.compare(0, 2, "--") != 0) {
+      positional_.push_back(arg);
+      continue;
+    }
+
+    auto const equals = arg.find('=');
+    if (equals != std::string::npos) {
+      flags_[arg.substr(2, equals - 2)] = arg.substr(equals + 1);
+      continue;
+    }
+
+    auto const name = arg.substr(2);
+    if (switches.count(name) != 0) {
+      flags_[name] = "";
+      continue;
+    }
+    if (i + 1 >= argc) {
+      ExitWithUsageError("Missing value for flag: " + arg);
+    }
+    flags_[name] = argv[++i];
+  }
+}
+
+std::string Flags::Get(std::string const& name,
+                       std::string const& default_value) const {
+  auto const found = flags_.find(name);
+  return found == flags_.end() ? default_value : found->second;
+}
+
+int Flags::GetInt(std::string const& name, int default_value) const {
+  auto const found = flags_.find(name);
+  if (found == flags_.end()) {
+    return default_value;
+  }
+  size_t parsed = 0;
+  auto value = 0;
+  try {
+    value = std::stoi(found->second, &parsed);
+  } catch (std::logic_error const&) {
+    // std::invalid_argument or std::out_of_range
+    parsed = 0;
+  }
+  if (parsed == 0 || parsed != found->second.size()) {
+    ExitWithUsageError("Not an integer: --" + name + "=" + found->second);
+  }
+  return value;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/// Command-line arguments split into positional arguments and flags. Flags are
+/// given as "--name value" or "--name=value", except for the names listed in
+/// `switches` which don't take a value. Malformed flags are usage errors: they
+/// are reported on stderr and the program exits with status 1.
+class Flags {
+ public:
+  /// Exits if a flag is missing its value.
+  Flags(int argc, char** argv, std::set<std::string> const& switches = {});
+
+  std::vector<std::string> const& GetPositional() const { return positional_; }
+
+  bool Has(std::string const& name) const { return flags_.count(name) != 0; }
+  std::string Get(std::string const& name,
+                  std::string const& default_value = "") const;
+  /// Exits if the value isn't an integer.
+  int GetInt(std::string const& name, int default_value) const;
+
+ private:
+  std::vector<std::string> positional_;
+  std::map<std::string, std::string> flags_;
+};
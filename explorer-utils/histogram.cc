@@ -0,0 +1,91 @@
+#include "histogram.h"
+
+#include <cstring>
+
+namespace {
+
+// Consecutive equal bytes (runs of floor or wall) would otherwise make every
+// increment wait on the previous one. Spreading them over several banks lets
+// them overlap.
+constexpr auto kNumBanks = 4;
+using Banks = std::array<Histogram, kNumBanks>;
+
+void AddToBanks(uint8_t const* data, size_t size, Banks& banks) {
+  size_t i = 0;
+  // Load 8 bytes at a time and pick them apart in registers
+  for (; size - i >= 8; i += 8) {
+    uint64_t word;
+    memcpy(&word, data + i, sizeof(word));
+    ++banks[0][word & 0xFF];
+    ++banks[1][(word >> 8) & 0xFF];
+    ++banks[2][(word >> 16) & 0xFF];
+    ++banks[3][(word >> 24) & 0xFF];
+    ++banks[0][(word >> 32) & 0xFF];
+    ++banks[1][(word >> 40) & 0xFF];
+    ++banks[2][(word >> 48) & 0xFF];
+    ++banks[3][word >> 56];
+  }
+  for (; i < size; ++i) {
+    ++banks[i % kNumBanks][data[i]];
+  }
+}
+
+void MergeBanks(Banks const& banks, Histogram& histogram) {
+  for (auto value = 0; value < 256; ++value) {
+    for (auto const& bank : banks) {
+      histogram[value] += bank[value];
+    }
+  }
+}
+
+template <typename GetCells>
+Histogram GetRoomsHistogram(std::vector<room_t> const& rooms,
+                            GetCells get_cells) {
+  Banks banks{};
+  for (auto const& room : rooms) {
+    AddToBanks(get_cells(room), kRoomArea, banks);
+  }
+  Histogram histogram{};
+  MergeBanks(banks, histogram);
+  return histogram;
+}
+
+Histogram GetHistogram(uint8_t const* data, size_t size) {
+  Histogram histogram{};
+  AddToHistogram(data, size, histogram);
+  return histogram;
+}
+
+}  // namespace
+
+void AddToHistogram(uint8_t const* data, size_t size, Histogram& histogram) {
+  Banks banks{};
+  AddToBanks(data, size, banks);
+  MergeBanks(banks, histogram);
+}
+
+Histogram GetTileHistogram(room_t const& room) {
+  return GetHistogram(room.tiles.data(), room.tiles.size());
+}
+
+Histogram GetTileHistogram(std::vector<room_t> const& rooms) {
+  return GetRoomsHistogram(
+      rooms, [](room_t const& room) { return room.tiles.data(); });
+}
+
+Histogram GetTileHistogram(AdventureStore const& store) {
+  return GetHistogram(store.tiles.data(), store.tiles.size());
+}
+
+Histogram GetObjectHistogram(room_t const& room) {
+  return GetHistogram(room.objects.data(), room.objects.size());
+}
+
+Histogram GetObjectHistogram(std::vector<room_t> const& rooms) {
+  return GetRoomsHistogram(
+      rooms, [](room_t const& room) { return room.objects.data(); });
+}
+
+Histogram GetObjectHistogram(AdventureStore const& store) {
+  return GetHistogram(store.objects.data(), store.objects.size());
+}
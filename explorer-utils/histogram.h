@@ -0,0 +1,23 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "adventure_store.h"
+#include "room.h"
+
+/// How many times each byte value appears.
+using Histogram = std::array<uint32_t, 256>;
+
+/// Adds every byte of `data` to `histogram`.
+void AddToHistogram(uint8_t const* data, size_t size, Histogram& histogram);
+
+Histogram GetTileHistogram(room_t const& room);
+Histogram GetTileHistogram(std::vector<room_t> const& rooms);
+Histogram GetTileHistogram(AdventureStore const& store);
+
+Histogram GetObjectHistogram(room_t const& room);
+Histogram GetObjectHistogram(std::vector<room_t> const& rooms);
+Histogram GetObjectHistogram(AdventureStore const& store);
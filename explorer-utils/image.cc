@@ -1,23 +1,84 @@
 #include "image.h"
 
-#include <array>
+#include <algorithm>
 
-#include "file.h"
+#include "stats.h"
 
-void Image::Blit(Image const& src, int x, int y) {
+void Image::Blit(ImageView const& src, int x, int y, int scale) {
+  STATS_COUNT(kStatBlits, 1);
+  auto const scaled_width = src.GetWidth() * scale;
   for (auto yy = 0; yy < src.GetHeight(); ++yy) {
+    auto const* const row = src.GetRow(yy);
+    auto* const dst = &pixels_[(yy * scale + y) * width_ + x];
+    if (scale == 1) {
+      std::copy(row, row + src.GetWidth(), dst);
+      continue;
+    }
+
+    // Widen the row once then replicate it for the rest of the block
     for (auto xx = 0; xx < src.GetWidth(); ++xx) {
-      Set(xx + x, yy + y, src.Get(xx, yy));
+      std::fill_n(dst + xx * scale, scale, row[xx]);
+    }
+    for (auto dy = 1; dy < scale; ++dy) {
+      std::copy(dst, dst + scaled_width, dst + dy * width_);
     }
   }
 }
 
-void Image::Blit(Image const& src, Image const& mask, int x, int y) {
+void Image::Blit(ImageView const& src, ImageView const& mask, int x, int y,
+                 int scale) {
+  STATS_COUNT(kStatBlits, 1);
   for (auto yy = 0; yy < src.GetHeight(); ++yy) {
-    for (auto xx = 0; xx < src.GetWidth(); ++xx) {
-      if (mask.Get(xx, yy) == color_black) {
-        Set(xx + x, yy + y, src.Get(xx, yy));
+    for (auto dy = 0; dy < scale; ++dy) {
+      auto* const dst = &pixels_[(yy * scale + dy + y) * width_ + x];
+      for (auto xx = 0; xx < src.GetWidth(); ++xx) {
+        if (mask.Get(xx, yy) == color_black) {
+          std::fill_n(dst + xx * scale, scale, src.Get(xx, yy));
+        }
       }
     }
   }
 }
+
+void Image::Fill(int x, int y, int width, int height, color_t const& c) {
+  for (auto yy = y; yy < y + height; ++yy) {
+    std::fill_n(&pixels_[yy * width_ + x], width, c);
+  }
+}
+
+void Image::Tint(int x, int y, int width, int height, color_t const& c) {
+  for (auto yy = y; yy < y + height; ++yy) {
+    for (auto xx = x; xx < x + width; ++xx) {
+      auto& p = pixels_[yy * width_ + xx];
+      p = color_t{static_cast<uint8_t>((p.r + c.r) / 2),
+                  static_cast<uint8_t>((p.g + c.g) / 2),
+                  static_cast<uint8_t>((p.b + c.b) / 2)};
+    }
+  }
+}
+
+void Image::Blend(int x, int y, int width, int height, color_t const& c,
+                  uint8_t alpha) {
+  auto const mix = [alpha](uint8_t dst, uint8_t src) {
+    return static_cast<uint8_t>((dst * (255 - alpha) + src * alpha) / 255);
+  };
+  for (auto yy = y; yy < y + height; ++yy) {
+    for (auto xx = x; xx < x + width; ++xx) {
+      auto& p = pixels_[yy * width_ + xx];
+      p = color_t{mix(p.r, c.r), mix(p.g, c.g), mix(p.b, c.b)};
+    }
+  }
+}
+
+void Image::Outline(int x, int y, int width, int height, color_t const& c,
+                    int thickness) {
+  for (auto yy = y; yy < y + height; ++yy) {
+    auto* const row = &pixels_[yy * width_];
+    if (yy < y + thickness || yy >= y + height - thickness) {
+      std::fill_n(row + x, width, c);
+      continue;
+    }
+    std::fill_n(row + x, thickness, c);
+    std::fill_n(row + x + width - thickness, thickness, c);
+  }
+}
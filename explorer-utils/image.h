@@ -4,6 +4,28 @@
 
 #include "color.h"
 
+/// Read-only view of pixels owned by something else (an `Image`, a
+/// `SpriteArena`, ...). `stride` is the distance between rows, in pixels.
+class ImageView {
+ public:
+  ImageView(color_t const* pixels, int width, int height, int stride)
+      : pixels_(pixels), width_(width), height_(height), stride_(stride) {}
+
+  color_t Get(int x, int y) const { return pixels_[y * stride_ + x]; }
+  color_t const* GetRow(int y) const { return pixels_ + y * stride_; }
+
+  int GetWidth() const { return width_; }
+  int GetHeight() const { return height_; }
+  int GetStride() const { return stride_; }
+  color_t const* GetData() const { return pixels_; }
+
+ private:
+  color_t const* pixels_;
+  int width_;
+  int height_;
+  int stride_;
+};
+
 class Image {
  public:
   Image(int width, int height)
@@ -14,13 +36,32 @@ class Image {
   color_t Get(int x, int y) const { return pixels_.at(y * width_ + x); }
   void Set(int x, int y, color_t const& c) { pixels_[y * width_ + x] = c; }
 
-  void Blit(Image const& src, int x, int y);
-  void Blit(Image const& src, Image const& mask, int x, int y);
+  /// Each source pixel becomes a `scale` x `scale` block (nearest neighbor)
+  /// with its top left corner at (`x`, `y`). Pixels where `mask` isn't black
+  /// are left untouched.
+  void Blit(ImageView const& src, int x, int y, int scale = 1);
+  void Blit(ImageView const& src, ImageView const& mask, int x, int y,
+            int scale = 1);
+
+  /// Sets every pixel of the rectangle to `c`.
+  void Fill(int x, int y, int width, int height, color_t const& c);
+  /// Blends `c` half and half over the rectangle.
+  void Tint(int x, int y, int width, int height, color_t const& c);
+  /// Blends `c` over the rectangle with an opacity of `alpha` / 255.
+  void Blend(int x, int y, int width, int height, color_t const& c,
+             uint8_t alpha);
+  /// Draws a border `thickness` pixels wide just inside the rectangle.
+  void Outline(int x, int y, int width, int height, color_t const& c,
+               int thickness = 1);
 
   int GetWidth() const { return width_; }
   int GetHeight() const { return height_; }
   std::vector<color_t> const& GetData() const { return pixels_; }
 
+  operator ImageView() const {
+    return ImageView(pixels_.data(), width_, height_, width_);
+  }
+
  private:
   int width_;
   int height_;
@@ -0,0 +1,329 @@
+#include "image_sink.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "png.h"
+#include "stats.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+static_assert(sizeof(color_t) == 3, "color_t rows are written as-is");
+
+constexpr auto kQoiOpIndex = 0x00;
+constexpr auto kQoiOpDiff = 0x40;
+constexpr auto kQoiOpLuma = 0x80;
+constexpr auto kQoiOpRun = 0xC0;
+constexpr auto kQoiOpRgb = 0xFE;
+constexpr auto kQoiMaxRun = 62;
+constexpr auto kQoiIndexSize = 64;
+
+void PutBigEndian(std::ostream& out, uint32_t value) {
+  char const bytes[] = {static_cast<char>(value >> 24),
+                        static_cast<char>(value >> 16),
+                        static_cast<char>(value >> 8),
+                        static_cast<char>(value)};
+  out.write(bytes, sizeof(bytes));
+}
+
+/// Base for sinks that write whatever they're given straight to a stream.
+class StreamSink : public ImageSink {
+ public:
+  StreamSink(std::unique_ptr<std::ostream> out, int width, int height)
+      : out_(std::move(out)), width_(width), height_(height) {}
+
+  void Finish() override {
+    if (rows_written_ != height_) {
+      throw std::runtime_error("Image is missing rows");
+    }
+    out_->flush();
+    if (!out_->good()) {
+      throw std::runtime_error("Failed to write image");
+    }
+  }
+
+ protected:
+  std::unique_ptr<std::ostream> out_;
+  int width_;
+  int height_;
+  int rows_written_ = 0;
+};
+
+class RawRgbSink : public StreamSink {
+ public:
+  using StreamSink::StreamSink;
+
+  void WriteRows(color_t const* pixels, int num_rows) override {
+    STATS_TIMER("write image");
+    STATS_COUNT(kStatPixelsWritten, static_cast<uint64_t>(width_) * num_rows);
+    out_->write(reinterpret_cast<char const*>(pixels),
+                static_cast<size_t>(width_) * num_rows * sizeof(color_t));
+    rows_written_ += num_rows;
+  }
+};
+
+class PpmSink : public RawRgbSink {
+ public:
+  PpmSink(std::unique_ptr<std::ostream> out, int width, int height)
+      : RawRgbSink(std::move(out), width, height) {
+    *out_ << "P6\n" << width << " " << height << "\n255\n";
+  }
+};
+
+class RawIndexedSink : public StreamSink {
+ public:
+  using StreamSink::StreamSink;
+
+  void WriteRows(color_t const* pixels, int num_rows) override {
+    STATS_TIMER("write image");
+    STATS_COUNT(kStatPixelsWritten, static_cast<uint64_t>(width_) * num_rows);
+    auto const num_pixels = static_cast<size_t>(width_) * num_rows;
+    std::vector<char> indices(num_pixels);
+    for (size_t i = 0; i < num_pixels; ++i) {
+      indices[i] = static_cast<char>(Lookup(pixels[i]));
+    }
+    out_->write(indices.data(), indices.size());
+    rows_written_ += num_rows;
+  }
+
+ private:
+  uint8_t Lookup(color_t const& c) {
+    auto const key = c.r | (c.g << 8) | (c.b << 16);
+    auto const found = cache_.find(key);
+    if (found != cache_.end()) {
+      return found->second;
+    }
+
+    uint8_t best = 0;
+    auto best_distance = INT32_MAX;
+    for (auto i = 0; i < kIndexedPalette.size(); ++i) {
+      auto const& p = kIndexedPalette[i];
+      auto const distance = (p.r - c.r) * (p.r - c.r) +
+                            (p.g - c.g) * (p.g - c.g) +
+                            (p.b - c.b) * (p.b - c.b);
+      if (distance < best_distance) {
+        best_distance = distance;
+        best = static_cast<uint8_t>(i);
+      }
+    }
+    cache_.emplace(key, best);
+    return best;
+  }
+
+  std::unordered_map<uint32_t, uint8_t> cache_;
+};
+
+/// https://qoiformat.org/qoi-specification.pdf. The encoder state carries over
+/// between rows so it streams naturally.
+class QoiSink : public StreamSink {
+ public:
+  QoiSink(std::unique_ptr<std::ostream> out, int width, int height)
+      : StreamSink(std::move(out), width, height) {
+    out_->write("qoif", 4);
+    PutBigEndian(*out_, width);
+    PutBigEndian(*out_, height);
+    out_->put(3);  // channels: RGB
+    out_->put(0);  // colorspace: sRGB with linear alpha
+  }
+
+  void WriteRows(color_t const* pixels, int num_rows) override {
+    STATS_TIMER("write image");
+    STATS_COUNT(kStatPixelsWritten, static_cast<uint64_t>(width_) * num_rows);
+    auto const num_pixels = static_cast<size_t>(width_) * num_rows;
+    std::vector<char> bytes;
+    bytes.reserve(num_pixels);
+    for (size_t i = 0; i < num_pixels; ++i) {
+      auto const& px = pixels[i];
+      if (px == previous_) {
+        if (++run_ == kQoiMaxRun) {
+          bytes.push_back(static_cast<char>(kQoiOpRun | (run_ - 1)));
+          run_ = 0;
+        }
+        continue;
+      }
+      if (run_ > 0) {
+        bytes.push_back(static_cast<char>(kQoiOpRun | (run_ - 1)));
+        run_ = 0;
+      }
+
+      // Alpha is always 255
+      auto const hash = (px.r * 3 + px.g * 5 + px.b * 7 + 255 * 11) %
+                        kQoiIndexSize;
+      if (index_used_[hash] && index_[hash] == px) {
+        bytes.push_back(static_cast<char>(kQoiOpIndex | hash));
+      } else {
+        index_[hash] = px;
+        index_used_[hash] = true;
+
+        auto const dr = static_cast<int8_t>(px.r - previous_.r);
+        auto const dg = static_cast<int8_t>(px.g - previous_.g);
+        auto const db = static_cast<int8_t>(px.b - previous_.b);
+        auto const dr_dg = dr - dg;
+        auto const db_dg = db - dg;
+        if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 &&
+            db <= 1) {
+          bytes.push_back(static_cast<char>(kQoiOpDiff | (dr + 2) << 4 |
+                                            (dg + 2) << 2 | (db + 2)));
+        } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 &&
+                   db_dg >= -8 && db_dg <= 7) {
+          bytes.push_back(static_cast<char>(kQoiOpLuma | (dg + 32)));
+          bytes.push_back(static_cast<char>((dr_dg + 8) << 4 | (db_dg + 8)));
+        } else {
+          bytes.insert(bytes.end(),
+                       {static_cast<char>(kQoiOpRgb), static_cast<char>(px.r),
+                        static_cast<char>(px.g), static_cast<char>(px.b)});
+        }
+      }
+      previous_ = px;
+    }
+    out_->write(bytes.data(), bytes.size());
+    rows_written_ += num_rows;
+  }
+
+  void Finish() override {
+    if (run_ > 0) {
+      out_->put(static_cast<char>(kQoiOpRun | (run_ - 1)));
+      run_ = 0;
+    }
+    char const end_marker[] = {0, 0, 0, 0, 0, 0, 0, 1};
+    out_->write(end_marker, sizeof(end_marker));
+    StreamSink::Finish();
+  }
+
+ private:
+  color_t previous_ = color_black;
+  int run_ = 0;
+  // The decoder starts with a transparent black index, which no opaque pixel
+  // can match; color_t has no alpha so track that separately
+  std::array<color_t, kQoiIndexSize> index_{};
+  std::array<bool, kQoiIndexSize> index_used_{};
+};
+
+}  // namespace
+
+std::array<color_t, 18> const kIndexedPalette = {
+    color_t{0x00, 0x00, 0x00}, color_t{0x00, 0x00, 0xAA},
+    color_t{0x00, 0xAA, 0x00}, color_t{0x00, 0xAA, 0xAA},
+    color_t{0xAA, 0x00, 0x00}, color_t{0xAA, 0x00, 0xAA},
+    color_t{0xAA, 0x55, 0x00}, color_t{0xAA, 0xAA, 0xAA},
+    color_t{0x55, 0x55, 0x55}, color_t{0x55, 0x55, 0xFF},
+    color_t{0x55, 0xFF, 0x55}, color_t{0x55, 0xFF, 0xFF},
+    color_t{0xFF, 0x55, 0x55}, color_t{0xFF, 0x55, 0xFF},
+    color_t{0xFF, 0xFF, 0x55}, color_t{0xFF, 0xFF, 0xFF},
+    color_t{0x00, 0xFF, 0xFF}, color_t{0xFF, 0x00, 0xFF}};
+
+ImageFormat ParseImageFormat(std::string const& name) {
+  if (name == "png") {
+    return ImageFormat::png;
+  }
+  if (name == "ppm") {
+    return ImageFormat::ppm;
+  }
+  if (name == "qoi") {
+    return ImageFormat::qoi;
+  }
+  if (name == "rgb") {
+    return ImageFormat::raw_rgb;
+  }
+  if (name == "indexed") {
+    return ImageFormat::raw_indexed;
+  }
+  throw std::invalid_argument("Unknown image format: "s + name);
+}
+
+std::string GetImageFormatExtension(ImageFormat format) {
+  switch (format) {
+    case ImageFormat::png:
+      return ".png";
+    case ImageFormat::ppm:
+      return ".ppm";
+    case ImageFormat::qoi:
+      return ".qoi";
+    case ImageFormat::raw_rgb:
+      return ".rgb";
+    case ImageFormat::raw_indexed:
+      return ".idx";
+  }
+  return "";
+}
+
+std::unique_ptr<ImageSink> OpenImageSink(std::string const& filename,
+                                         ImageFormat format, int width,
+                                         int height,
+                                         PngOptions const& png_options) {
+  return OpenImageSink(OpenOutputStream(filename), format, width, height,
+                       png_options);
+}
+
+std::unique_ptr<ImageSink> OpenImageSink(std::unique_ptr<std::ostream> out,
+                                         ImageFormat format, int width,
+                                         int height,
+                                         PngOptions const& png_options) {
+  switch (format) {
+    case ImageFormat::png:
+      return std::make_unique<PngWriter>(std::move(out), width, height,
+                                         png_options);
+    case ImageFormat::ppm:
+      return std::make_unique<PpmSink>(std::move(out), width, height);
+    case ImageFormat::qoi:
+      return std::make_unique<QoiSink>(std::move(out), width, height);
+    case ImageFormat::raw_rgb:
+      return std::make_unique<RawRgbSink>(std::move(out), width, height);
+    case ImageFormat::raw_indexed:
+      return std::make_unique<RawIndexedSink>(std::move(out), width, height);
+  }
+  throw std::invalid_argument("Unknown image format");
+}
+
+void WriteImage(std::string const& filename, ImageFormat format,
+                ImageView const& image, PngOptions const& png_options) {
+  if (format == ImageFormat::png) {
+    WritePng(filename, image, png_options);
+    return;
+  }
+
+  auto const sink = OpenImageSink(filename, format, image.GetWidth(),
+                                  image.GetHeight(), png_options);
+  for (auto y = 0; y < image.GetHeight(); ++y) {
+    sink->WriteRows(image.GetRow(y), 1);
+  }
+  sink->Finish();
+}
+
+std::string EncodeImage(ImageFormat format, ImageView const& image,
+                        PngOptions const& png_options) {
+  std::ostringstream out;
+  if (format == ImageFormat::png) {
+    WritePng(out, image, png_options);
+    return out.str();
+  }
+
+  // The sink gets a stream of its own over the same buffer
+  auto const sink =
+      OpenImageSink(std::make_unique<std::ostream>(out.rdbuf()), format,
+                    image.GetWidth(), image.GetHeight(), png_options);
+  for (auto y = 0; y < image.GetHeight(); ++y) {
+    sink->WriteRows(image.GetRow(y), 1);
+  }
+  sink->Finish();
+  return out.str();
+}
+
+std::unique_ptr<std::ostream> OpenOutputStream(std::string const& filename) {
+  if (filename == "-") {
+    return std::make_unique<std::ostream>(std::cout.rdbuf());
+  }
+
+  auto out = std::make_unique<std::ofstream>(filename, std::ios_base::binary);
+  if (!out->good()) {
+    throw std::runtime_error("Failed to open file: "s + filename);
+  }
+  return out;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+#include "color.h"
+#include "image.h"
+
+struct PngOptions;
+
+/// Destination for an image that accepts rows as they are rendered, so that a
+/// renderer never has to hold a whole image in memory.
+class ImageSink {
+ public:
+  virtual ~ImageSink() = default;
+
+  /// `pixels` holds `num_rows` rows of the sink's width, back to back.
+  virtual void WriteRows(color_t const* pixels, int num_rows) = 0;
+
+  /// Must be called once every row has been written. Throws
+  /// std::runtime_error on I/O failure or if rows are missing.
+  virtual void Finish() = 0;
+};
+
+enum class ImageFormat {
+  png,
+  /// Binary (P6) PPM
+  ppm,
+  /// The Quite OK Image format, RGB
+  qoi,
+  /// Headerless 8-bit RGB
+  raw_rgb,
+  /// Headerless, one byte per pixel indexing `kIndexedPalette`
+  raw_indexed,
+};
+
+/// Palette for `ImageFormat::raw_indexed`: the 16 EGA colors followed by the
+/// two CGA colors that aren't also EGA colors. Colors outside of it (e.g. from
+/// overlays) are written as the nearest entry.
+extern std::array<color_t, 18> const kIndexedPalette;
+
+/// Accepts "png", "ppm", "qoi", "rgb" and "indexed". Throws
+/// std::invalid_argument for anything else.
+ImageFormat ParseImageFormat(std::string const& name);
+
+/// Extension for files of `format`, including the leading '.'.
+std::string GetImageFormatExtension(ImageFormat format);
+
+/// A `filename` of "-" writes to stdout. Raw formats have no header so
+/// several images can be streamed back to back. Throws std::runtime_error if
+/// the file can't be created.
+std::unique_ptr<ImageSink> OpenImageSink(std::string const& filename,
+                                         ImageFormat format, int width,
+                                         int height,
+                                         PngOptions const& png_options);
+/// Like the above but writes to `out`.
+std::unique_ptr<ImageSink> OpenImageSink(std::unique_ptr<std::ostream> out,
+                                         ImageFormat format, int width,
+                                         int height,
+                                         PngOptions const& png_options);
+
+/// Writes a whole image at once. Prefer this for PNG since knowing every pixel
+/// up front allows writing a palette image.
+void WriteImage(std::string const& filename, ImageFormat format,
+                ImageView const& image, PngOptions const& png_options);
+
+/// Like `WriteImage` but returns the file's contents instead, e.g. to hand to
+/// an `AsyncFileWriter`.
+std::string EncodeImage(ImageFormat format, ImageView const& image,
+                        PngOptions const& png_options);
+
+/// `filename` or, for "-", an unowned stream over stdout.
+std::unique_ptr<std::ostream> OpenOutputStream(std::string const& filename);
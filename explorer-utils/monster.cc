@@ -1,19 +1,128 @@
 #include "monster.h"
 
+#include <algorithm>
+
 #include "file.h"
+#include "stats.h"
 
 namespace {
 constexpr auto kMonDatRecordSize = 0x1F;
+constexpr auto kMonDatNameOffset = 0x00;
+constexpr auto kMonDatNameMaxLength = 15;
+constexpr auto kMonDatLevelOffset = 0x10;
+constexpr auto kMonDatExpOffset = 0x12;
 constexpr auto kMonDatGfxIdOffset = 0x16;
+
+constexpr auto kMonDatUnknownOffsets =
+    std::array<int, kNumMonsterUnknowns>{0x11, 0x13, 0x14, 0x15, 0x17, 0x18,
+                                         0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E};
 }  // namespace
 
 std::vector<monster_t> LoadMonsterData(std::string const& filename) {
-  auto const monster_data = ReadBinaryFile(filename);
+  return ParseMonsterData(ReadBinaryFile(filename));
+}
 
+std::vector<monster_t> ParseMonsterData(
+    std::vector<uint8_t> const& monster_data) {
+  STATS_TIMER("parse monsters");
   std::vector<monster_t> builder;
   for (int i = 0; i < monster_data.size() / kMonDatRecordSize; ++i) {
     auto const gfx = monster_data[i * kMonDatRecordSize + kMonDatGfxIdOffset];
     builder.push_back(monster_t{gfx});
   }
   return builder;
-}
\ No newline at end of file
+}
+
+std::vector<monster_t> LoadMonsterData(std::string const& filename,
+                                       Diagnostics& diagnostics,
+                                       size_t num_sprites) {
+  std::vector<uint8_t> monster_data;
+  if (!ReadInputFile(filename, monster_data, diagnostics)) {
+    return {};
+  }
+  return ParseMonsterData(filename, monster_data, diagnostics, num_sprites);
+}
+
+std::vector<monster_t> ParseMonsterData(
+    std::string const& filename, std::vector<uint8_t> const& monster_data,
+    Diagnostics& diagnostics, size_t num_sprites) {
+  STATS_TIMER("parse monsters");
+  auto const num_monsters = monster_data.size() / kMonDatRecordSize;
+  std::vector<monster_t> builder;
+  builder.reserve(num_monsters);
+  for (int i = 0; i < num_monsters; ++i) {
+    auto const offset = static_cast<size_t>(i) * kMonDatRecordSize;
+    auto const* const record = monster_data.data() + offset;
+
+    if (record[kMonDatNameOffset] > kMonDatNameMaxLength) {
+      diagnostics.push_back(
+          {filename, i, offset + kMonDatNameOffset, "name",
+           "length " + std::to_string(record[kMonDatNameOffset]) +
+               " is over " + std::to_string(kMonDatNameMaxLength)});
+    }
+    // Graphics are 1-based
+    auto const gfx = record[kMonDatGfxIdOffset];
+    if (gfx == 0) {
+      diagnostics.push_back({filename, i, offset + kMonDatGfxIdOffset, "gfx",
+                             "0 isn't a graphic, they start at 1"});
+    } else if (num_sprites != 0 && gfx > num_sprites) {
+      diagnostics.push_back({filename, i, offset + kMonDatGfxIdOffset, "gfx",
+                             std::to_string(gfx) + " is past the last of " +
+                                 std::to_string(num_sprites) + " sprites"});
+    }
+    builder.push_back(monster_t{gfx});
+  }
+
+  if (auto const extra = monster_data.size() % kMonDatRecordSize;
+      extra != 0) {
+    diagnostics.push_back({filename, static_cast<int>(num_monsters),
+                           num_monsters * kMonDatRecordSize, "record",
+                           std::to_string(extra) +
+                               " trailing bytes don't make a whole monster",
+                           true});
+  }
+  return builder;
+}
+
+int MonsterTable::Find(std::string const& name) const {
+  auto const found = name_to_index.find(name);
+  return found == name_to_index.end() ? -1 : found->second;
+}
+
+MonsterTable LoadMonsterTable(std::string const& filename) {
+  return ParseMonsterTable(ReadBinaryFile(filename));
+}
+
+MonsterTable ParseMonsterTable(std::vector<uint8_t> const& monster_data) {
+  STATS_TIMER("parse monsters");
+  auto const num_monsters = monster_data.size() / kMonDatRecordSize;
+
+  MonsterTable table;
+  table.names.reserve(num_monsters);
+  table.levels.reserve(num_monsters);
+  table.exps.reserve(num_monsters);
+  table.ids.reserve(num_monsters);
+  for (auto& column : table.unknowns) {
+    column.reserve(num_monsters);
+  }
+
+  for (int i = 0; i < num_monsters; ++i) {
+    auto const* const record = monster_data.data() + i * kMonDatRecordSize;
+
+    // Pascal string: length byte followed by up to 15 characters
+    auto const name_length =
+        std::min<int>(record[kMonDatNameOffset], kMonDatNameMaxLength);
+    auto const* const name =
+        reinterpret_cast<char const*>(record + kMonDatNameOffset + 1);
+    table.names.emplace_back(name, name_length);
+    table.name_to_index.emplace(table.names.back(), i);
+
+    table.levels.push_back(record[kMonDatLevelOffset]);
+    table.exps.push_back(record[kMonDatExpOffset]);
+    table.ids.push_back(record[kMonDatGfxIdOffset]);
+    for (auto u = 0; u < kNumMonsterUnknowns; ++u) {
+      table.unknowns[u].push_back(record[kMonDatUnknownOffsets[u]]);
+    }
+  }
+  return table;
+}
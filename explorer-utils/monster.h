@@ -1,12 +1,59 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "diagnostic.h"
+
 struct monster_t {
   uint8_t gfx;
 };
 
 std::vector<monster_t> LoadMonsterData(
     std::string const& filename = "PYMON.DAT");
+
+/// Validating version of the above for untrusted files: problems are added to
+/// `diagnostics` instead of throwing or being ignored. `num_sprites` is the
+/// number of cells in PYMON.PIC, to check graphics against, or 0 to skip that
+/// check. Every whole record is still returned.
+std::vector<monster_t> LoadMonsterData(std::string const& filename,
+                                       Diagnostics& diagnostics,
+                                       size_t num_sprites = 0);
+
+/// Versions of the above for files that are already in memory. `filename` is
+/// only used to label diagnostics.
+std::vector<monster_t> ParseMonsterData(
+    std::vector<uint8_t> const& monster_data);
+std::vector<monster_t> ParseMonsterData(
+    std::string const& filename, std::vector<uint8_t> const& monster_data,
+    Diagnostics& diagnostics, size_t num_sprites = 0);
+
+/// Bytes of the PYMON.DAT record that aren't understood yet, named after their
+/// letters in the record documentation (A, C, E, F, H-O).
+constexpr auto kNumMonsterUnknowns = 12;
+
+/// Every field of PYMON.DAT, stored column by column so that scanning one
+/// statistic across many monsters only touches that statistic. Row `i` of
+/// every column is record `i` of the file.
+struct MonsterTable {
+  std::vector<std::string> names;
+  std::vector<uint8_t> levels;
+  std::vector<uint8_t> exps;
+  // Same as monster_t::gfx
+  std::vector<uint8_t> ids;
+  std::array<std::vector<uint8_t>, kNumMonsterUnknowns> unknowns;
+
+  size_t size() const { return names.size(); }
+
+  /// Index of the first monster called `name`, or -1 if there is none.
+  int Find(std::string const& name) const;
+
+  // Backs `Find`
+  std::unordered_map<std::string, int> name_to_index;
+};
+
+MonsterTable LoadMonsterTable(std::string const& filename = "PYMON.DAT");
+MonsterTable ParseMonsterTable(std::vector<uint8_t> const& monster_data);
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/// What a room_t::objects value is. Objects below 'd' are the room's monster
+/// (see room_t::monster_id), the rest are drawn with tiles from
+/// EGAPICS/CGAPICS.
+struct object_info_t {
+  /// Index into EGAPICS/CGAPICS (0-based, unlike room_t::tiles)
+  uint8_t tile = 0;
+  /// Index of the tile to use as a mask, 0 for none
+  uint8_t mask = 0;
+  /// As shown by the game, see docs/tile-descriptions.html
+  char const* name = nullptr;
+  bool is_monster = false;
+  /// Whether the player can walk through it without doing anything first
+  bool passable = true;
+};
+
+/// Every possible room_t::objects value. Anything that isn't a known object
+/// has no name and draws nothing.
+inline constexpr std::array<object_info_t, 256> kObjectTable = [] {
+  std::array<object_info_t, 256> table{};
+  // Only 'a' to 'c' are used, but the game treats anything below 'd' as one
+  for (auto object = 1; object < 'd'; ++object) {
+    table[object] = {0, 0, nullptr, true, false};
+  }
+  for (auto object = 'a'; object <= 'c'; ++object) {
+    table[object].name = "a monster";
+  }
+  table['d'] = {47, 0, "magical darkness", false, true};
+  table['e'] = {21, 64, "treasure chest", false, false};
+  table['f'] = {46, 66, "some smoke", false, true};
+  table['g'] = {29, 0, "a moveable block", false, false};
+  table['h'] = {37, 0, "a door", false, false};  // Vertical
+  table['i'] = {36, 0, "a door", false, false};  // Horizontal
+  table['j'] = {21, 0, "a funny looking chest", false, false};
+  table['k'] = {2, 0, "a soft section of wall", false, false};
+  table['l'] = {42, 0, "a soft piece of wall", false, false};
+  table['m'] = {18, 0, "a soft pile of rubble", false, false};
+  table['n'] = {22, 69, "an old body", false, false};
+  table['o'] = {17, 70, "old bones", false, false};
+  table['p'] = {49, 71, "an old stone coffin", false, false};
+  table['q'] = {54, 65, "an old grave", false, false};
+  table['r'] = {0, 0, "a movable glass block", false, false};
+  table['s'] = {74, 72, "a old skeleton", false, false};
+  table['t'] = {75, 73, "a old skeleton", false, false};
+  table['u'] = {79, 0, "a hollow obilisk", false, false};
+  table['v'] = {82, 83, "just some blood", false, true};
+  table['w'] = {59, 81, "a stone marker", false, false};
+  return table;
+}();
+
+constexpr object_info_t const& GetObjectInfo(uint8_t object) {
+  return kObjectTable[object];
+}
+
+/// Same as above for objects known at compile time, which must exist.
+template <uint8_t Object>
+constexpr object_info_t const& GetObjectInfo() {
+  static_assert(kObjectTable[Object].name != nullptr, "Unknown object");
+  return kObjectTable[Object];
+}
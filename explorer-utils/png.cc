@@ -0,0 +1,625 @@
+#include "png.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "stats.h"
+#include "thread_pool.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+constexpr auto kRgbComponents = 3;
+static_assert(sizeof(color_t) == kRgbComponents,
+              "color_t rows are written to the PNG as-is");
+
+constexpr auto kColorTypeRgb = 2;
+constexpr auto kColorTypePalette = 3;
+constexpr auto kColorTypeRgba = 6;
+
+constexpr auto kMaxPaletteSize = 256;
+
+constexpr auto kFilterNone = 0;
+constexpr auto kFilterSub = 1;
+constexpr auto kFilterUp = 2;
+constexpr auto kFilterAverage = 3;
+constexpr auto kFilterPaeth = 4;
+constexpr auto kNumFilters = 5;
+
+constexpr auto kWindowSize = 32768;
+constexpr auto kMinMatch = 3;
+constexpr auto kMaxMatch = 258;
+constexpr auto kHashBits = 15;
+// Levels above this would shift the match chain length out of range
+constexpr auto kMaxLevel = 9;
+constexpr auto kMaxStoredBlock = 65535;
+
+// Parts of an image smaller than this are not worth a task of their own
+constexpr auto kMinBytesPerJob = 256 * 1024;
+
+constexpr auto kAdlerModulus = 65521;
+// Largest number of bytes that can be summed before the Adler-32 sums overflow
+constexpr auto kAdlerMaxRun = 5552;
+
+constexpr auto kPngSignature =
+    std::array<uint8_t, 8>{0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+// zlib header: deflate with a 32K window
+constexpr auto kZlibHeader = std::array<uint8_t, 2>{0x78, 0x9C};
+
+// RFC 1951 3.2.5
+constexpr auto kLengthBase = std::array<uint16_t, 29>{
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr auto kLengthExtraBits = std::array<uint8_t, 29>{
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+    2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr auto kDistanceBase = std::array<uint16_t, 30>{
+    1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+constexpr auto kDistanceExtraBits = std::array<uint8_t, 30>{
+    0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+constexpr std::array<uint32_t, 256> MakeCrcTable() {
+  std::array<uint32_t, 256> table{};
+  for (uint32_t n = 0; n < 256; ++n) {
+    auto c = n;
+    for (auto k = 0; k < 8; ++k) {
+      c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+    }
+    table[n] = c;
+  }
+  return table;
+}
+
+constexpr auto kCrcTable = MakeCrcTable();
+
+uint32_t UpdateCrc(uint32_t crc, uint8_t const* data, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    crc = kCrcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+uint32_t UpdateAdler(uint32_t adler, uint8_t const* data, size_t size) {
+  uint32_t a = adler & 0xFFFF;
+  uint32_t b = adler >> 16;
+  while (size > 0) {
+    auto const run = std::min<size_t>(size, kAdlerMaxRun);
+    for (size_t i = 0; i < run; ++i) {
+      a += data[i];
+      b += a;
+    }
+    a %= kAdlerModulus;
+    b %= kAdlerModulus;
+    data += run;
+    size -= run;
+  }
+  return (b << 16) | a;
+}
+
+void PutBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+  out.push_back(value >> 24);
+  out.push_back(value >> 16);
+  out.push_back(value >> 8);
+  out.push_back(value);
+}
+
+void WriteChunk(std::ostream& out, char const* type, uint8_t const* data,
+                size_t size) {
+  std::vector<uint8_t> header;
+  PutBigEndian(header, static_cast<uint32_t>(size));
+  header.insert(header.end(), type, type + 4);
+  auto crc = UpdateCrc(0xFFFFFFFF, header.data() + 4, 4);
+  crc = UpdateCrc(crc, data, size) ^ 0xFFFFFFFF;
+
+  out.write(reinterpret_cast<char const*>(header.data()), header.size());
+  out.write(reinterpret_cast<char const*>(data), size);
+  std::vector<uint8_t> footer;
+  PutBigEndian(footer, crc);
+  out.write(reinterpret_cast<char const*>(footer.data()), footer.size());
+}
+
+void WriteHeader(std::ostream& out, int width, int height, int bit_depth,
+                 int color_type) {
+  out.write(reinterpret_cast<char const*>(kPngSignature.data()),
+            kPngSignature.size());
+
+  std::vector<uint8_t> ihdr;
+  PutBigEndian(ihdr, width);
+  PutBigEndian(ihdr, height);
+  ihdr.push_back(bit_depth);
+  ihdr.push_back(color_type);
+  ihdr.push_back(0);  // compression: deflate
+  ihdr.push_back(0);  // filter: adaptive
+  ihdr.push_back(0);  // interlace: none
+  WriteChunk(out, "IHDR", ihdr.data(), ihdr.size());
+}
+
+uint8_t Paeth(int a, int b, int c) {
+  auto const p = a + b - c;
+  auto const pa = std::abs(p - a);
+  auto const pb = std::abs(p - b);
+  auto const pc = std::abs(p - c);
+  if (pa <= pb && pa <= pc) {
+    return a;
+  }
+  return pb <= pc ? b : c;
+}
+
+/// Appends the filter type and filtered `row` to `out`. `previous` is the
+/// unfiltered row above (all zeros for the first row). With `adaptive`, every
+/// filter is tried and the one with the smallest sum of absolute values wins,
+/// which is the usual heuristic for truecolor images. Otherwise the row is
+/// left unfiltered, which is what the spec recommends for palette images.
+void FilterRow(uint8_t const* row, uint8_t const* previous, size_t row_bytes,
+               int bpp, bool adaptive, std::vector<uint8_t>& out) {
+  if (!adaptive) {
+    out.push_back(kFilterNone);
+    out.insert(out.end(), row, row + row_bytes);
+    return;
+  }
+
+  std::vector<uint8_t> candidates(kNumFilters * row_bytes);
+  for (size_t i = 0; i < row_bytes; ++i) {
+    auto const a = i >= bpp ? row[i - bpp] : 0;
+    auto const b = previous[i];
+    auto const c = i >= bpp ? previous[i - bpp] : 0;
+    candidates[kFilterNone * row_bytes + i] = row[i];
+    candidates[kFilterSub * row_bytes + i] = row[i] - a;
+    candidates[kFilterUp * row_bytes + i] = row[i] - b;
+    candidates[kFilterAverage * row_bytes + i] = row[i] - (a + b) / 2;
+    candidates[kFilterPaeth * row_bytes + i] = row[i] - Paeth(a, b, c);
+  }
+
+  auto best_filter = kFilterNone;
+  auto best_cost = ~size_t{0};
+  for (auto filter = 0; filter < kNumFilters; ++filter) {
+    size_t cost = 0;
+    for (size_t i = 0; i < row_bytes; ++i) {
+      cost += std::abs(static_cast<int8_t>(candidates[filter * row_bytes + i]));
+    }
+    if (cost < best_cost) {
+      best_cost = cost;
+      best_filter = filter;
+    }
+  }
+
+  out.push_back(best_filter);
+  auto const* const best = candidates.data() + best_filter * row_bytes;
+  out.insert(out.end(), best, best + row_bytes);
+}
+
+uint32_t Hash(uint8_t const* data) {
+  auto const v = (data[0] << 16) | (data[1] << 8) | data[2];
+  return (v * 2654435761u) >> (32 - kHashBits);
+}
+
+}  // namespace
+
+/// Raw deflate (RFC 1951) encoder that only uses the fixed Huffman codes.
+/// Image data is so repetitive that the matches matter far more than the
+/// entropy coding.
+class DeflateStream {
+ public:
+  /// `row_stride` and `pixel_stride` (in bytes) are the distances that
+  /// repeated rows and runs of the same pixel are found at.
+  DeflateStream(int level, size_t row_stride, size_t pixel_stride)
+      : level_(std::clamp(level, 0, kMaxLevel)),
+        row_stride_(row_stride),
+        pixel_stride_(pixel_stride) {}
+
+  /// Data that matches may refer to but that isn't part of the output, e.g.
+  /// the end of the part of the image that another thread is compressing.
+  void SetDictionary(uint8_t const* data, size_t size) {
+    window_.assign(data, data + size);
+  }
+
+  /// Compresses `data`, referring back to at most 32KiB of earlier data.
+  void Write(uint8_t const* data, size_t size, bool final_block) {
+    if (level_ <= 0) {
+      WriteStored(data, size, final_block);
+    } else {
+      WriteFixed(data, size, final_block);
+    }
+    if (final_block && bit_count_ > 0) {
+      PutBits(0, 8 - bit_count_);
+    }
+  }
+
+  /// Ends the output on a byte boundary with an empty stored block, so that
+  /// independently compressed streams can be concatenated.
+  void Align() {
+    PutBits(0, 3);
+    if (bit_count_ > 0) {
+      PutBits(0, 8 - bit_count_);
+    }
+    out_.insert(out_.end(), {0x00, 0x00, 0xFF, 0xFF});
+  }
+
+  std::vector<uint8_t>& GetOutput() { return out_; }
+
+ private:
+  void WriteStored(uint8_t const* data, size_t size, bool final_block) {
+    do {
+      auto const block_size = std::min<size_t>(size, kMaxStoredBlock);
+      auto const last = block_size == size;
+      PutBits(final_block && last ? 1 : 0, 1);
+      PutBits(0, 2);  // BTYPE: stored
+      if (bit_count_ > 0) {
+        PutBits(0, 8 - bit_count_);
+      }
+      out_.push_back(block_size & 0xFF);
+      out_.push_back(block_size >> 8);
+      out_.push_back(~block_size & 0xFF);
+      out_.push_back((~block_size >> 8) & 0xFF);
+      out_.insert(out_.end(), data, data + block_size);
+      data += block_size;
+      size -= block_size;
+    } while (size > 0);
+  }
+
+  void WriteFixed(uint8_t const* data, size_t size, bool final_block) {
+    PutBits(final_block ? 1 : 0, 1);
+    PutBits(1, 2);  // BTYPE: fixed Huffman
+
+    auto const history = window_.size();
+    window_.insert(window_.end(), data, data + size);
+    auto const* const buf = window_.data();
+    auto const end = window_.size();
+
+    // Level 1 only looks at the previous pixel and row so needs no hashing
+    auto const max_chain = level_ >= 2 ? 4 << (level_ - 2) : 0;
+    std::vector<int32_t> head;
+    std::vector<int32_t> prev;
+    if (max_chain > 0) {
+      head.assign(1 << kHashBits, -1);
+      prev.assign(end, -1);
+    }
+    auto const insert = [&](size_t pos) {
+      if (max_chain > 0 && pos + kMinMatch <= end) {
+        auto const h = Hash(buf + pos);
+        prev[pos] = head[h];
+        head[h] = static_cast<int32_t>(pos);
+      }
+    };
+    for (size_t pos = 0; pos < history; ++pos) {
+      insert(pos);
+    }
+
+    auto pos = history;
+    while (pos < end) {
+      auto const max_length =
+          static_cast<int>(std::min<size_t>(kMaxMatch, end - pos));
+      auto best_length = 0;
+      auto best_distance = 0;
+      auto const try_match = [&](size_t candidate) {
+        auto length = 0;
+        while (length < max_length &&
+               buf[candidate + length] == buf[pos + length]) {
+          ++length;
+        }
+        if (length > best_length) {
+          best_length = length;
+          best_distance = static_cast<int>(pos - candidate);
+        }
+      };
+
+      // Runs of one color and rows repeated from above are by far the most
+      // common matches in tiled pixel art, so check them before the chain
+      for (auto const distance : {pixel_stride_, row_stride_}) {
+        if (distance <= pos && distance <= kWindowSize &&
+            best_length < max_length) {
+          try_match(pos - distance);
+        }
+      }
+      if (max_chain > 0 && max_length >= kMinMatch) {
+        auto candidate = head[Hash(buf + pos)];
+        for (auto chain = 0; candidate >= 0 && chain < max_chain &&
+                             best_length < max_length;
+             ++chain) {
+          if (pos - candidate > kWindowSize) {
+            break;
+          }
+          try_match(candidate);
+          candidate = prev[candidate];
+        }
+      }
+
+      if (best_length >= kMinMatch) {
+        PutMatch(best_length, best_distance);
+        for (auto i = 0; i < best_length; ++i) {
+          insert(pos + i);
+        }
+        pos += best_length;
+      } else {
+        PutLiteral(buf[pos]);
+        insert(pos);
+        ++pos;
+      }
+    }
+
+    PutHuffman(0, 7);  // end of block (256)
+
+    if (window_.size() > kWindowSize) {
+      window_.erase(window_.begin(), window_.end() - kWindowSize);
+    }
+  }
+
+  void PutBits(uint32_t bits, int count) {
+    bit_buffer_ |= bits << bit_count_;
+    bit_count_ += count;
+    while (bit_count_ >= 8) {
+      out_.push_back(bit_buffer_ & 0xFF);
+      bit_buffer_ >>= 8;
+      bit_count_ -= 8;
+    }
+  }
+
+  /// Huffman codes are packed starting from the most significant bit.
+  void PutHuffman(uint32_t code, int length) {
+    uint32_t reversed = 0;
+    for (auto i = 0; i < length; ++i) {
+      reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    PutBits(reversed, length);
+  }
+
+  void PutLiteral(int literal) {
+    if (literal < 144) {
+      PutHuffman(0x30 + literal, 8);
+    } else {
+      PutHuffman(0x190 + literal - 144, 9);
+    }
+  }
+
+  void PutMatch(int length, int distance) {
+    auto code = 0;
+    while (code + 1 < kLengthBase.size() && kLengthBase[code + 1] <= length) {
+      ++code;
+    }
+    auto const symbol = 257 + code;
+    if (symbol < 280) {
+      PutHuffman(symbol - 256, 7);
+    } else {
+      PutHuffman(0xC0 + symbol - 280, 8);
+    }
+    PutBits(length - kLengthBase[code], kLengthExtraBits[code]);
+
+    code = 0;
+    while (code + 1 < kDistanceBase.size() &&
+           kDistanceBase[code + 1] <= distance) {
+      ++code;
+    }
+    PutHuffman(code, 5);
+    PutBits(distance - kDistanceBase[code], kDistanceExtraBits[code]);
+  }
+
+  int level_;
+  size_t row_stride_;
+  size_t pixel_stride_;
+
+  // Uncompressed data that later matches can refer back to
+  std::vector<uint8_t> window_;
+
+  std::vector<uint8_t> out_;
+  uint32_t bit_buffer_ = 0;
+  int bit_count_ = 0;
+};
+
+void WritePng(std::ostream& out, int width, int height, int components,
+              uint8_t const* data, int stride, PngOptions const& options) {
+  STATS_TIMER("write png");
+  STATS_COUNT(kStatPixelsWritten, static_cast<uint64_t>(width) * height);
+  // Pixel art rarely uses more than a handful of colors, in which case a
+  // palette (packed down to as few bits as possible) shrinks the data that
+  // has to be compressed by 3-24x
+  std::unordered_map<uint32_t, uint8_t> palette_lookup;
+  std::vector<uint32_t> palette;
+  std::vector<uint8_t> indices;
+  indices.reserve(static_cast<size_t>(width) * height);
+  for (auto y = 0; y < height && palette.size() <= kMaxPaletteSize; ++y) {
+    auto const* const row = data + static_cast<size_t>(y) * stride;
+    for (auto x = 0; x < width; ++x) {
+      auto const* const pixel = row + x * components;
+      auto const color = pixel[0] | (pixel[1] << 8) | (pixel[2] << 16) |
+                         ((components == 4 ? pixel[3] : 0xFFu) << 24);
+      auto const found = palette_lookup.find(color);
+      if (found != palette_lookup.end()) {
+        indices.push_back(found->second);
+        continue;
+      }
+      if (palette.size() == kMaxPaletteSize) {
+        palette.push_back(color);
+        break;
+      }
+      palette_lookup.emplace(color, static_cast<uint8_t>(palette.size()));
+      indices.push_back(static_cast<uint8_t>(palette.size()));
+      palette.push_back(color);
+    }
+  }
+  auto const use_palette = palette.size() <= kMaxPaletteSize;
+
+  auto bit_depth = 8;
+  auto color_type = components == 4 ? kColorTypeRgba : kColorTypeRgb;
+  size_t row_bytes = static_cast<size_t>(width) * components;
+  auto bpp = components;
+  std::vector<uint8_t> packed;
+  if (use_palette) {
+    color_type = kColorTypePalette;
+    bit_depth = palette.size() <= 2 ? 1 : palette.size() <= 4 ? 2
+                : palette.size() <= 16 ? 4 : 8;
+    row_bytes = (static_cast<size_t>(width) * bit_depth + 7) / 8;
+    bpp = 1;
+
+    auto const pixels_per_byte = 8 / bit_depth;
+    packed.assign(row_bytes * height, 0);
+    for (auto y = 0; y < height; ++y) {
+      for (auto x = 0; x < width; ++x) {
+        auto const shift =
+            (pixels_per_byte - 1 - x % pixels_per_byte) * bit_depth;
+        packed[y * row_bytes + x / pixels_per_byte] |=
+            indices[static_cast<size_t>(y) * width + x] << shift;
+      }
+    }
+  }
+
+  std::vector<uint8_t> filtered;
+  filtered.reserve((row_bytes + 1) * height);
+  std::vector<uint8_t> const zeros(row_bytes, 0);
+  for (auto y = 0; y < height; ++y) {
+    auto const* const row = use_palette
+                                ? packed.data() + y * row_bytes
+                                : data + static_cast<size_t>(y) * stride;
+    auto const* const previous = y == 0        ? zeros.data()
+                                 : use_palette ? row - row_bytes
+                                               : row - stride;
+    FilterRow(row, previous, row_bytes, bpp,
+              !use_palette && options.level >= 2, filtered);
+  }
+
+  // Split on row boundaries; each part keeps the data before it as a
+  // dictionary so compression barely suffers for being done in parallel
+  auto const filtered_row = row_bytes + 1;
+  // The split only depends on the size, so the output is the same however
+  // many threads the pool has
+  auto const jobs = std::max<size_t>(1, filtered.size() / kMinBytesPerJob);
+  auto const rows_per_job = (height + jobs - 1) / jobs;
+  std::vector<std::vector<uint8_t>> parts(jobs);
+  ParallelFor(0, jobs, 1, [&](size_t job) {
+    auto const begin =
+        std::min<size_t>(filtered.size(), job * rows_per_job * filtered_row);
+    auto const end = std::min<size_t>(filtered.size(),
+                                      (job + 1) * rows_per_job * filtered_row);
+    auto const last = job == jobs - 1;
+
+    DeflateStream deflate(options.level, filtered_row, bpp);
+    auto const dictionary = std::min<size_t>(begin, kWindowSize);
+    deflate.SetDictionary(filtered.data() + begin - dictionary, dictionary);
+    deflate.Write(filtered.data() + begin, end - begin, last);
+    if (!last) {
+      deflate.Align();
+    }
+    parts[job] = std::move(deflate.GetOutput());
+  });
+
+  std::vector<uint8_t> idat(kZlibHeader.begin(), kZlibHeader.end());
+  for (auto const& part : parts) {
+    idat.insert(idat.end(), part.begin(), part.end());
+  }
+  PutBigEndian(idat, UpdateAdler(1, filtered.data(), filtered.size()));
+
+  WriteHeader(out, width, height, bit_depth, color_type);
+  if (use_palette) {
+    std::vector<uint8_t> plte;
+    std::vector<uint8_t> trns;
+    auto transparent = false;
+    for (auto const color : palette) {
+      plte.insert(plte.end(), {static_cast<uint8_t>(color),
+                               static_cast<uint8_t>(color >> 8),
+                               static_cast<uint8_t>(color >> 16)});
+      trns.push_back(color >> 24);
+      transparent |= (color >> 24) != 0xFF;
+    }
+    WriteChunk(out, "PLTE", plte.data(), plte.size());
+    if (transparent) {
+      WriteChunk(out, "tRNS", trns.data(), trns.size());
+    }
+  }
+  WriteChunk(out, "IDAT", idat.data(), idat.size());
+  WriteChunk(out, "IEND", nullptr, 0);
+}
+
+void WritePng(std::string const& filename, int width, int height,
+              int components, uint8_t const* data, int stride,
+              PngOptions const& options) {
+  auto const stream = OpenOutputStream(filename);
+  auto& out = *stream;
+  WritePng(out, width, height, components, data, stride, options);
+
+  out.flush();
+  if (!out.good()) {
+    throw std::runtime_error("Failed to write file: "s + filename);
+  }
+}
+
+void WritePng(std::string const& filename, ImageView const& image,
+              PngOptions const& options) {
+  WritePng(filename, image.GetWidth(), image.GetHeight(), kRgbComponents,
+           reinterpret_cast<uint8_t const*>(image.GetData()),
+           image.GetStride() * kRgbComponents, options);
+}
+
+void WritePng(std::ostream& out, ImageView const& image,
+              PngOptions const& options) {
+  WritePng(out, image.GetWidth(), image.GetHeight(), kRgbComponents,
+           reinterpret_cast<uint8_t const*>(image.GetData()),
+           image.GetStride() * kRgbComponents, options);
+}
+
+PngWriter::PngWriter(std::string const& filename, int width, int height,
+                     PngOptions const& options)
+    : PngWriter(OpenOutputStream(filename), width, height, options) {}
+
+PngWriter::PngWriter(std::unique_ptr<std::ostream> out, int width, int height,
+                     PngOptions const& options)
+    : out_(std::move(out)),
+      width_(width),
+      height_(height),
+      level_(options.level),
+      previous_row_(static_cast<size_t>(width) * kRgbComponents, 0),
+      deflate_(std::make_unique<DeflateStream>(
+          options.level, width * kRgbComponents + 1, kRgbComponents)) {
+  WriteHeader(*out_, width, height, 8, kColorTypeRgb);
+
+  auto& output = deflate_->GetOutput();
+  output.insert(output.end(), kZlibHeader.begin(), kZlibHeader.end());
+}
+
+PngWriter::~PngWriter() = default;
+
+void PngWriter::WriteRows(color_t const* pixels, int num_rows) {
+  STATS_TIMER("write png");
+  STATS_COUNT(kStatPixelsWritten, static_cast<uint64_t>(width_) * num_rows);
+  auto const row_bytes = previous_row_.size();
+  std::vector<uint8_t> filtered;
+  filtered.reserve(num_rows * (row_bytes + 1));
+  for (auto y = 0; y < num_rows; ++y) {
+    auto const* const row =
+        reinterpret_cast<uint8_t const*>(pixels + y * width_);
+    FilterRow(row, previous_row_.data(), row_bytes, kRgbComponents,
+              level_ >= 2, filtered);
+    previous_row_.assign(row, row + row_bytes);
+  }
+  rows_written_ += num_rows;
+  adler_ = UpdateAdler(adler_, filtered.data(), filtered.size());
+
+  deflate_->Write(filtered.data(), filtered.size(), false);
+  auto& output = deflate_->GetOutput();
+  WriteChunk(*out_, "IDAT", output.data(), output.size());
+  output.clear();
+}
+
+void PngWriter::Finish() {
+  STATS_TIMER("write png");
+  if (rows_written_ != height_) {
+    throw std::runtime_error("PNG is missing rows");
+  }
+
+  deflate_->Write(nullptr, 0, true);
+  auto& output = deflate_->GetOutput();
+  PutBigEndian(output, adler_);
+  WriteChunk(*out_, "IDAT", output.data(), output.size());
+  output.clear();
+  WriteChunk(*out_, "IEND", nullptr, 0);
+
+  out_->flush();
+  if (!out_->good()) {
+    throw std::runtime_error("Failed to write PNG");
+  }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "color.h"
+#include "image.h"
+#include "image_sink.h"
+
+/// Trades encoding speed for file size.
+struct PngOptions {
+  /// 0 stores the data uncompressed. 1 only looks for repeats of the previous
+  /// pixel or row, which is most of what tile-based pixel art has to offer.
+  /// 2-9 also search for earlier matches, harder at higher levels. Anything
+  /// outside 0-9 is clamped.
+  int level = 5;
+};
+
+/// Writes a whole 8-bit RGB (`components` = 3) or RGBA (`components` = 4)
+/// image. `stride` is the distance between rows, in bytes. Images with at most
+/// 256 colors are written with a palette. A `filename` of "-" writes to
+/// stdout. Throws std::runtime_error on I/O failure.
+void WritePng(std::string const& filename, int width, int height,
+              int components, uint8_t const* data, int stride,
+              PngOptions const& options = {});
+void WritePng(std::string const& filename, ImageView const& image,
+              PngOptions const& options = {});
+
+/// Versions of the above that write to `out` (e.g. to encode into memory),
+/// leaving the caller to check it for errors.
+void WritePng(std::ostream& out, int width, int height, int components,
+              uint8_t const* data, int stride, PngOptions const& options = {});
+void WritePng(std::ostream& out, ImageView const& image,
+              PngOptions const& options = {});
+
+class DeflateStream;
+
+/// Writes an 8-bit RGB PNG a few rows at a time so that the whole image never
+/// has to exist in memory. Rows are compressed as soon as they're handed over;
+/// only the last 32KiB of image data is kept around for back-references.
+class PngWriter : public ImageSink {
+ public:
+  /// Throws std::runtime_error if the file can't be created.
+  PngWriter(std::string const& filename, int width, int height,
+            PngOptions const& options = {});
+  PngWriter(std::unique_ptr<std::ostream> out, int width, int height,
+            PngOptions const& options = {});
+  ~PngWriter() override;
+
+  void WriteRows(color_t const* pixels, int num_rows) override;
+  void Finish() override;
+
+ private:
+  std::unique_ptr<std::ostream> out_;
+  int width_;
+  int height_;
+  int level_;
+  int rows_written_ = 0;
+
+  std::vector<uint8_t> previous_row_;
+  uint32_t adler_ = 1;
+  std::unique_ptr<DeflateStream> deflate_;
+};
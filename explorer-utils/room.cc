@@ -1,13 +1,24 @@
 #include "room.h"
 
+#include <algorithm>
+#include <bitset>
+#include <cerrno>
 #include <cstring>
 #include <iostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #include "file.h"
+#include "stats.h"
 
-namespace {
+using namespace std::string_literals;
 
-constexpr auto kRoomRecordSize = 0x168;
+namespace {
 
 constexpr auto kRoomTileOffset = 0x1;
 constexpr auto kRoomObjectOffset = 0xA1;
@@ -15,16 +26,77 @@ constexpr auto kRoomMonsterIdOffset = 0x141;
 constexpr auto kRoomMonsterCountOffset = 0x142;
 constexpr auto kRoomNorthIdOffset = 0x143;
 constexpr auto kRoomIdOffset = 0x149;
+constexpr auto kRoomOddDesignRoomOffset = 0x14C;
+constexpr auto kRoomNameOffset = 0x14D;
+
+constexpr std::array<char const*, 7> kRoomExitFields = {
+    "nav.north", "nav.east", "nav.south",      "nav.west",
+    "nav.up",    "nav.down", "odd_design_room"};
+constexpr std::array<int, 7> kRoomExitOffsets = {
+    kRoomNorthIdOffset,     kRoomNorthIdOffset + 1, kRoomNorthIdOffset + 2,
+    kRoomNorthIdOffset + 3, kRoomNorthIdOffset + 4, kRoomNorthIdOffset + 5,
+    kRoomOddDesignRoomOffset};
+
+/// Checks the fields of one record that can be checked on their own.
+void ValidateRoom(std::string const& filename, int index,
+                  uint8_t const* record, size_t num_monsters,
+                  Diagnostics& diagnostics) {
+  auto const offset = static_cast<size_t>(index) * kRoomRecordSize;
+
+  if (record[kRoomNameOffset] > kRoomNameMaxLength) {
+    diagnostics.push_back(
+        {filename, index, offset + kRoomNameOffset, "name",
+         "length " + std::to_string(record[kRoomNameOffset]) + " is over " +
+             std::to_string(kRoomNameMaxLength)});
+  }
+
+  auto num_unknown = 0;
+  auto first_unknown = 0;
+  auto has_monster = false;
+  for (auto i = 0; i < kRoomArea; ++i) {
+    auto const object = record[kRoomObjectOffset + i];
+    auto const& info = GetObjectInfo(object);
+    has_monster |= info.is_monster;
+    if (object != 0 && info.name == nullptr && !info.is_monster) {
+      first_unknown = num_unknown++ == 0 ? i : first_unknown;
+    }
+  }
+  if (num_unknown != 0) {
+    diagnostics.push_back(
+        {filename, index, offset + kRoomObjectOffset + first_unknown,
+         "objects",
+         std::to_string(record[kRoomObjectOffset + first_unknown]) +
+             " isn't a known object (" + std::to_string(num_unknown) +
+             " unknown in the room)"});
+  }
+
+  // monster_id is 1-based
+  auto const monster_id = record[kRoomMonsterIdOffset];
+  if (has_monster && monster_id == 0) {
+    diagnostics.push_back({filename, index, offset + kRoomMonsterIdOffset,
+                           "monster_id", "room has monsters but no id"});
+  } else if (has_monster && num_monsters != 0 && monster_id > num_monsters) {
+    diagnostics.push_back(
+        {filename, index, offset + kRoomMonsterIdOffset, "monster_id",
+         std::to_string(monster_id) + " is past the last of " +
+             std::to_string(num_monsters) + " monsters"});
+  }
+}
+
+/// Bytes read, 0 at the end of the input or negative on error.
+long ReadSome(int fd, uint8_t* data, size_t size) {
+#ifdef _WIN32
+  return _read(fd, data, static_cast<unsigned>(size));
+#else
+  return read(fd, data, size);
+#endif
+}
 
 }  // namespace
 
 uint8_t room_t::GetTile(int x, int y) const {
-  auto const tile = tiles[y * kRoomWidth + x];
   // Different traps are different ASCII characters
-  if (tile > 84) {
-    return 21;
-  }
-  return tile;
+  return GetTrapInfo(tiles[y * kRoomWidth + x]).tile;
 }
 
 auto room_t::GetObjectType(int x, int y) const -> object_type {
@@ -32,119 +104,167 @@ auto room_t::GetObjectType(int x, int y) const -> object_type {
   if (tile == 0) {
     return object_type::none;
   }
-  if (tile <= 'c') {
+  if (GetObjectInfo(tile).is_monster) {
     return object_type::monster;
   }
   return object_type::object;
 }
 
 uint8_t room_t::GetObject(int x, int y) const {
-  auto const tile = objects[y * kRoomWidth + x];
-  return GetObjectTile(tile);
+  return GetObjectInfo(objects[y * kRoomWidth + x]).tile;
 }
 
-int GetObjectTile(uint8_t object) {
-  switch (object) {
-    case 'd':  // Magical darkness
-      return 47;
-    case 'e':  // Treasure chest
-      return 21;
-    case 'f':  // Smoke
-      return 46;
-    case 'g':  // Movable block
-      return 29;
-    case 'h':  // Door (vertical)
-      return 37;
-    case 'i':  // Door (horizontal)
-      return 36;
-    case 'j':  // Funny looking chest
-      return 21;
-    case 'k':  // Soft section of wall
-      return 2;
-    case 'l':  // Soft piece of wall
-      return 42;
-    case 'm':  // Soft pile of rubble
-      return 18;
-    case 'n':  // Old body
-      return 22;
-    case 'o':  // Old bones
-      return 17;
-    case 'p':  // Old stone coffin
-      return 49;
-    case 'q':  // Old grave
-      return 54;
-    case 'r':  // Movable glass block:
-      return 0;
-    case 's':  // Old skeleton
-      return 74;
-    case 't':  // Old skeleton
-      return 75;
-    case 'u':  // Hollow obilisk
-      return 79;
-    case 'v':  // "Just some blood"
-      return 82;
-    case 'w':  // Stone marker
-      return 59;
+void CountTraps(uint8_t const* tiles,
+                std::array<uint32_t, kNumTrapIds>& counts) {
+  for (auto i = 0; i < kRoomArea; ++i) {
+    ++counts[GetTrapInfo(tiles[i]).id];
   }
-
-  return 0;
 }
 
-int GetObjectTileMask(uint8_t object) {
-  switch (object) {
-    case 'e':  // Treasure chest
-      return 64;
-    case 'f':  // Smoke
-      return 66;
-    case 'n':  // Old body
-      return 69;
-    case 'o':  // Old bones
-      return 70;
-    case 'p':  // Old stone coffin
-      return 71;
-    case 'q':  // Old grave
-      return 65;
-    case 's':  // Old skeleton
-      return 72;
-    case 't':  // Old skeleton
-      return 73;
-    case 'v':  // Just some blood
-      return 83;
-    case 'w':  // Stone marker
-      return 81;
-  }
+room_t ParseRoom(uint8_t const* record) {
+  room_t room;
+  memcpy(room.tiles.data(), record + kRoomTileOffset, kRoomArea);
+  memcpy(room.objects.data(), record + kRoomObjectOffset, kRoomArea);
+  room.monster_id = record[kRoomMonsterIdOffset];
+  room.monster_count = record[kRoomMonsterCountOffset];
+
+  room.nav.north = record[kRoomNorthIdOffset];
+  room.nav.east = record[kRoomNorthIdOffset + 1];
+  room.nav.south = record[kRoomNorthIdOffset + 2];
+  room.nav.west = record[kRoomNorthIdOffset + 3];
+  room.nav.up = record[kRoomNorthIdOffset + 4];
+  room.nav.down = record[kRoomNorthIdOffset + 5];
+
+  room.id = record[kRoomIdOffset];
+  room.odd_design_room = record[kRoomOddDesignRoomOffset];
 
-  return 0;
+  // Pascal string: length byte followed by up to 26 characters
+  auto const name_length =
+      std::min<int>(record[kRoomNameOffset], kRoomNameMaxLength);
+  room.name.assign(
+      reinterpret_cast<char const*>(record + kRoomNameOffset + 1),
+      name_length);
+  return room;
 }
 
 std::vector<room_t> LoadRooms(std::string const& filename) {
+  return ParseRooms(ReadBinaryFile(filename));
+}
+
+std::vector<room_t> ParseRooms(std::vector<uint8_t> const& data) {
+  STATS_TIMER("parse rooms");
   std::vector<room_t> builder;
+  auto const num_rooms = data.size() / kRoomRecordSize;
+  STATS_COUNT(kStatRoomsParsed, num_rooms);
+  builder.reserve(num_rooms);
+  for (auto i = 0; i < num_rooms; ++i) {
+    builder.push_back(ParseRoom(data.data() + i * kRoomRecordSize));
+  }
+  return builder;
+}
 
-  auto const data = ReadBinaryFile(filename);
+std::vector<room_t> LoadRooms(std::string const& filename,
+                              Diagnostics& diagnostics,
+                              size_t num_monsters) {
+  std::vector<uint8_t> data;
+  if (!ReadInputFile(filename, data, diagnostics)) {
+    return {};
+  }
+  return ParseRooms(filename, data, diagnostics, num_monsters);
+}
+
+std::vector<room_t> ParseRooms(std::string const& filename,
+                               std::vector<uint8_t> const& data,
+                               Diagnostics& diagnostics,
+                               size_t num_monsters) {
+  STATS_TIMER("parse rooms");
   auto const num_rooms = data.size() / kRoomRecordSize;
+  STATS_COUNT(kStatRoomsParsed, num_rooms);
+  std::vector<room_t> builder;
+  builder.reserve(num_rooms);
+  std::bitset<256> ids;
   for (auto i = 0; i < num_rooms; ++i) {
-    room_t room;
-
-    auto const room_base = i * kRoomRecordSize;
-    memcpy(room.tiles.data(), data.data() + room_base + kRoomTileOffset,
-           kRoomArea);
-    memcpy(room.objects.data(), data.data() + room_base + kRoomObjectOffset,
-           kRoomArea);
-    room.monster_id = data[room_base + kRoomMonsterIdOffset];
-    room.monster_count = data[room_base + kRoomMonsterCountOffset];
-
-    room.nav.north = data[room_base + kRoomNorthIdOffset];
-    room.nav.east = data[room_base + kRoomNorthIdOffset + 1];
-    room.nav.south = data[room_base + kRoomNorthIdOffset + 2];
-    room.nav.west = data[room_base + kRoomNorthIdOffset + 3];
-    room.nav.up = data[room_base + kRoomNorthIdOffset + 4];
-    room.nav.down = data[room_base + kRoomNorthIdOffset + 5];
-
-    room.id = data[room_base + kRoomIdOffset];
-
-    builder.emplace_back(std::move(room));
+    auto const offset = static_cast<size_t>(i) * kRoomRecordSize;
+    auto const* const record = data.data() + offset;
+    ValidateRoom(filename, i, record, num_monsters, diagnostics);
+    builder.push_back(ParseRoom(record));
+
+    auto const id = builder.back().id;
+    if (ids[id]) {
+      diagnostics.push_back({filename, i, offset + kRoomIdOffset, "id",
+                             std::to_string(id) + " is used twice"});
+    }
+    ids[id] = true;
+  }
+
+  if (num_rooms == 0) {
+    diagnostics.push_back({filename, -1, 0, "record", "no whole rooms", true});
+  }
+  if (auto const extra = data.size() % kRoomRecordSize; extra != 0) {
+    diagnostics.push_back({filename, static_cast<int>(num_rooms),
+                           num_rooms * kRoomRecordSize, "record",
+                           std::to_string(extra) +
+                               " trailing bytes don't make a whole room",
+                           true});
   }
 
-  // // TODO
+  // Exits can point forwards, so they can only be checked once every id is
+  // known
+  for (auto i = 0; i < num_rooms; ++i) {
+    auto const offset = static_cast<size_t>(i) * kRoomRecordSize;
+    auto const& room = builder[i];
+    std::array<uint8_t, 7> const destinations = {
+        room.nav.north, room.nav.east, room.nav.south,          room.nav.west,
+        room.nav.up,    room.nav.down, room.odd_design_room};
+    for (auto exit = 0; exit < destinations.size(); ++exit) {
+      if (destinations[exit] != 0 && !ids[destinations[exit]]) {
+        diagnostics.push_back(
+            {filename, i, offset + kRoomExitOffsets[exit],
+             kRoomExitFields[exit],
+             "no room has id " + std::to_string(destinations[exit])});
+      }
+    }
+  }
   return builder;
 }
+
+RoomReader::RoomReader(std::istream& in) : in_(&in) {}
+
+RoomReader::RoomReader(int fd) : fd_(fd) {}
+
+bool RoomReader::Next(room_t& room) {
+  size_t filled = 0;
+  if (in_ != nullptr) {
+    in_->read(reinterpret_cast<char*>(record_.data()), record_.size());
+    filled = in_->gcount();
+    if (in_->bad()) {
+      throw std::runtime_error("Failed to read room "s +
+                               std::to_string(count_));
+    }
+  } else {
+    // Pipes hand data over in whatever chunks they like
+    while (filled < record_.size()) {
+      auto const result =
+          ReadSome(fd_, record_.data() + filled, record_.size() - filled);
+      if (result == 0) {
+        break;
+      }
+      if (result < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw std::runtime_error("Failed to read room "s +
+                                 std::to_string(count_));
+      }
+      filled += result;
+    }
+  }
+
+  if (filled < record_.size()) {
+    return false;
+  }
+  room = ParseRoom(record_.data());
+  STATS_COUNT(kStatRoomsParsed, 1);
+  ++count_;
+  return true;
+}
@@ -2,12 +2,18 @@
 
 #include <array>
 #include <cstdint>
+#include <istream>
 #include <string>
 #include <vector>
 
+#include "diagnostic.h"
+#include "object.h"
+#include "trap.h"
+
 constexpr auto kRoomWidth = 20;
 constexpr auto kRoomHeight = 8;
 constexpr auto kRoomArea = kRoomWidth * kRoomHeight;
+constexpr auto kRoomNameMaxLength = 26;
 
 struct room_t {
   // uint8_t unknown;
@@ -31,17 +37,82 @@ struct room_t {
   uint8_t id;
   // uint8_t unknown;
   // uint8_t unknown;
-  // uint8_t unknown;
-  // std::string name;
+  // Where odd design tiles teleport to
+  uint8_t odd_design_room;
+  // At most kRoomNameMaxLength characters
+  std::string name;
 
   enum class object_type { none, monster, object };
 
+  /// Traps are all drawn with the trap tile, see `GetTrapInfo` to tell them
+  /// apart.
   uint8_t GetTile(int x, int y) const;
   object_type GetObjectType(int x, int y) const;
   uint8_t GetObject(int x, int y) const;
 };
 
-int GetObjectTile(uint8_t object);
-int GetObjectTileMask(uint8_t object);
+/// Adds how many times each trap appears in a room's `tiles` (kRoomArea
+/// room_t::tiles values, e.g. from `AdventureStore::GetTiles`) to `counts`,
+/// indexed by `trap_info_t::id`.
+void CountTraps(uint8_t const* tiles,
+                std::array<uint32_t, kNumTrapIds>& counts);
 
 std::vector<room_t> LoadRooms(std::string const& filename);
+
+/// Validating version of the above for untrusted files: problems are added to
+/// `diagnostics` instead of throwing or being ignored, e.g. a trailing partial
+/// record, exits to rooms that don't exist or monsters without a valid
+/// `monster_id`. `num_monsters` is the number of PYMON.DAT records, or 0 to
+/// only check that rooms with monsters have a monster_id. Every whole record
+/// is still returned.
+std::vector<room_t> LoadRooms(std::string const& filename,
+                              Diagnostics& diagnostics,
+                              size_t num_monsters = 0);
+
+/// Versions of the above for files that are already in memory. `filename` is
+/// only used to label diagnostics.
+std::vector<room_t> ParseRooms(std::vector<uint8_t> const& data);
+std::vector<room_t> ParseRooms(std::string const& filename,
+                               std::vector<uint8_t> const& data,
+                               Diagnostics& diagnostics,
+                               size_t num_monsters = 0);
+
+/// Size of one room in an RMS file.
+constexpr auto kRoomRecordSize = 0x168;
+
+/// Decodes one `kRoomRecordSize` record of an RMS file.
+room_t ParseRoom(uint8_t const* record);
+
+/// Reads rooms one record at a time, so that the first room can be used
+/// before the rest of the file has arrived and memory use doesn't grow with
+/// the file. A trailing partial record is ignored, like in `LoadRooms`.
+class RoomReader {
+ public:
+  /// `in` must outlive the reader.
+  explicit RoomReader(std::istream& in);
+  /// Reads from a file descriptor (e.g. a pipe), which isn't closed.
+  explicit RoomReader(int fd);
+
+  /// Reads the next room into `room`. Returns false at the end of the input.
+  /// Throws std::runtime_error on read errors.
+  bool Next(room_t& room);
+
+  /// Rooms read so far.
+  int GetCount() const { return count_; }
+
+ private:
+  std::istream* in_ = nullptr;
+  int fd_ = -1;
+  int count_ = 0;
+  std::array<uint8_t, kRoomRecordSize> record_;
+};
+
+/// Calls `callback(room)` for every room of `in` as soon as it's read.
+template <typename Callback>
+void ForEachRoom(std::istream& in, Callback callback) {
+  RoomReader reader(in);
+  room_t room;
+  while (reader.Next(room)) {
+    callback(room);
+  }
+}
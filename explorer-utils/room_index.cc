@@ -0,0 +1,380 @@
+#include "room_index.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+#include "object.h"
+
+namespace {
+
+constexpr auto kMagic = std::array<char, 8>{'E', 'X', 'P', 'L', 'R', 'I', 'D',
+                                            'X'};
+// Reads back differently on a machine with the other byte order
+constexpr uint32_t kByteOrderMark = 0x01020304;
+// Every table starts on this boundary so it can be used in place
+constexpr size_t kTableAlignment = 8;
+
+struct FileHeader {
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t byte_order_mark;
+  uint64_t file_size;
+  uint32_t file_count;
+  uint32_t room_count;
+  uint64_t key_count;
+  uint64_t posting_count;
+  // From the start of the file
+  uint64_t files_offset;
+  uint64_t rooms_offset;
+  uint64_t keys_offset;
+  uint64_t postings_offset;
+  uint64_t strings_offset;
+  uint64_t strings_size;
+};
+
+struct FileEntry {
+  // Into the string table
+  uint32_t name_offset;
+  uint32_t name_size;
+};
+
+struct RoomEntry {
+  uint32_t file;
+  uint32_t room;
+  // Into the string table
+  uint32_t name_offset;
+  uint32_t name_size;
+};
+
+struct KeyEntry {
+  uint64_t key;
+  // Index of the first posting, not bytes
+  uint64_t first;
+  uint64_t count;
+};
+
+uint64_t MakeKey(IndexTerm term, uint32_t value) {
+  return static_cast<uint64_t>(term) << 32 | value;
+}
+
+size_t AlignUp(size_t offset) {
+  return (offset + kTableAlignment - 1) / kTableAlignment * kTableAlignment;
+}
+
+std::string ToLower(std::string text) {
+  std::transform(text.begin(), text.end(), text.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return text;
+}
+
+template <typename T>
+T const* GetTable(MappedFile const& file, uint64_t offset) {
+  return reinterpret_cast<T const*>(file.data() + offset);
+}
+
+FileHeader GetHeader(MappedFile const& file) {
+  FileHeader header;
+  memcpy(&header, file.data(), sizeof(header));
+  return header;
+}
+
+/// Whether `count` entries of `size` bytes starting at `offset` are inside
+/// the file.
+bool IsInFile(MappedFile const& file, uint64_t offset, uint64_t count,
+              size_t size) {
+  return offset % kTableAlignment == 0 && offset <= file.size() &&
+         count <= (file.size() - offset) / size;
+}
+
+}  // namespace
+
+uint32_t MakeTrigramTerm(char const* text) {
+  auto const byte = [&](int i) {
+    return static_cast<uint32_t>(
+        std::tolower(static_cast<unsigned char>(text[i])));
+  };
+  return byte(0) << 16 | byte(1) << 8 | byte(2);
+}
+
+void RoomIndexWriter::AddFile(std::string const& filename,
+                              std::vector<room_t> const& rooms) {
+  auto const file = static_cast<uint32_t>(filenames_.size());
+  filenames_.push_back(filename);
+
+  for (auto i = 0; i < rooms.size(); ++i) {
+    auto const& room = rooms[i];
+    auto const global_room = static_cast<uint32_t>(rooms_.size());
+    rooms_.push_back(room_ref_t{file, static_cast<uint32_t>(i)});
+    room_names_.push_back(room.name);
+
+    auto const add = [&](IndexTerm term, uint32_t value) {
+      postings_.emplace_back(MakeKey(term, value), global_room);
+    };
+
+    auto any_placed_monster = false;
+    for (auto y = 0; y < kRoomHeight; ++y) {
+      for (auto x = 0; x < kRoomWidth; ++x) {
+        auto const index = y * kRoomWidth + x;
+        auto const tile = room.tiles[index];
+        auto const object = room.objects[index];
+        add(IndexTerm::tile, tile);
+        if (object == 0) {
+          continue;
+        }
+        add(IndexTerm::object, object);
+        any_placed_monster |= GetObjectInfo(object).is_monster;
+        if (x > 0) {
+          add(IndexTerm::adjacent, MakeAdjacentTerm(room.tiles[index - 1],
+                                                    object));
+        }
+        if (x < kRoomWidth - 1) {
+          add(IndexTerm::adjacent, MakeAdjacentTerm(room.tiles[index + 1],
+                                                    object));
+        }
+        if (y > 0) {
+          add(IndexTerm::adjacent,
+              MakeAdjacentTerm(room.tiles[index - kRoomWidth], object));
+        }
+        if (y < kRoomHeight - 1) {
+          add(IndexTerm::adjacent,
+              MakeAdjacentTerm(room.tiles[index + kRoomWidth], object));
+        }
+      }
+    }
+
+    // Placed monsters are there whatever the count says
+    if (room.monster_id != 0 &&
+        (room.monster_count != 0 || any_placed_monster)) {
+      add(IndexTerm::monster, room.monster_id);
+    }
+
+    for (auto c = 0; c + 3 <= room.name.size(); ++c) {
+      add(IndexTerm::trigram, MakeTrigramTerm(room.name.data() + c));
+    }
+  }
+}
+
+void RoomIndexWriter::Write(std::string const& filename) const {
+  auto postings = postings_;
+  std::sort(postings.begin(), postings.end());
+  postings.erase(std::unique(postings.begin(), postings.end()),
+                 postings.end());
+
+  std::vector<KeyEntry> keys;
+  std::vector<uint32_t> rooms;
+  rooms.reserve(postings.size());
+  for (auto const& [key, room] : postings) {
+    if (keys.empty() || keys.back().key != key) {
+      keys.push_back(KeyEntry{key, rooms.size(), 0});
+    }
+    ++keys.back().count;
+    rooms.push_back(room);
+  }
+
+  std::string strings;
+  std::vector<FileEntry> file_table;
+  for (auto const& name : filenames_) {
+    file_table.push_back(FileEntry{static_cast<uint32_t>(strings.size()),
+                                   static_cast<uint32_t>(name.size())});
+    strings += name;
+  }
+  std::vector<RoomEntry> room_table;
+  for (auto i = 0; i < rooms_.size(); ++i) {
+    room_table.push_back(RoomEntry{rooms_[i].file, rooms_[i].room,
+                                   static_cast<uint32_t>(strings.size()),
+                                   static_cast<uint32_t>(
+                                       room_names_[i].size())});
+    strings += room_names_[i];
+  }
+
+  FileHeader header{};
+  header.magic = kMagic;
+  header.version = kRoomIndexVersion;
+  header.byte_order_mark = kByteOrderMark;
+  header.file_count = static_cast<uint32_t>(file_table.size());
+  header.room_count = static_cast<uint32_t>(room_table.size());
+  header.key_count = keys.size();
+  header.posting_count = rooms.size();
+  header.files_offset = AlignUp(sizeof(header));
+  header.rooms_offset =
+      AlignUp(header.files_offset + file_table.size() * sizeof(FileEntry));
+  header.keys_offset =
+      AlignUp(header.rooms_offset + room_table.size() * sizeof(RoomEntry));
+  header.postings_offset =
+      AlignUp(header.keys_offset + keys.size() * sizeof(KeyEntry));
+  header.strings_offset =
+      AlignUp(header.postings_offset + rooms.size() * sizeof(uint32_t));
+  header.strings_size = strings.size();
+  header.file_size = AlignUp(header.strings_offset + strings.size());
+
+  std::vector<uint8_t> out(header.file_size, 0);
+  memcpy(out.data(), &header, sizeof(header));
+  // An index of nothing (every input file skipped) has empty tables, whose
+  // data() may be null, which memcpy doesn't allow even for 0 bytes
+  auto const copy = [&out](uint64_t offset, void const* data, size_t size) {
+    if (size != 0) {
+      memcpy(out.data() + offset, data, size);
+    }
+  };
+  copy(header.files_offset, file_table.data(),
+       file_table.size() * sizeof(FileEntry));
+  copy(header.rooms_offset, room_table.data(),
+       room_table.size() * sizeof(RoomEntry));
+  copy(header.keys_offset, keys.data(), keys.size() * sizeof(KeyEntry));
+  copy(header.postings_offset, rooms.data(), rooms.size() * sizeof(uint32_t));
+  copy(header.strings_offset, strings.data(), strings.size());
+
+  ReplaceFile(filename, out.data(), out.size());
+}
+
+RoomIndex::RoomIndex(std::unique_ptr<MappedFile> file)
+    : file_(std::move(file)) {}
+
+std::unique_ptr<RoomIndex> RoomIndex::Open(std::string const& filename) {
+  std::unique_ptr<MappedFile> file;
+  try {
+    file = std::make_unique<MappedFile>(filename);
+  } catch (std::runtime_error const&) {
+    return nullptr;
+  }
+
+  if (file->size() < sizeof(FileHeader)) {
+    return nullptr;
+  }
+  auto const header = GetHeader(*file);
+  if (header.magic != kMagic || header.version != kRoomIndexVersion ||
+      header.byte_order_mark != kByteOrderMark ||
+      header.file_size != file->size() ||
+      !IsInFile(*file, header.files_offset, header.file_count,
+                sizeof(FileEntry)) ||
+      !IsInFile(*file, header.rooms_offset, header.room_count,
+                sizeof(RoomEntry)) ||
+      !IsInFile(*file, header.keys_offset, header.key_count,
+                sizeof(KeyEntry)) ||
+      !IsInFile(*file, header.postings_offset, header.posting_count,
+                sizeof(uint32_t)) ||
+      !IsInFile(*file, header.strings_offset, header.strings_size, 1)) {
+    return nullptr;
+  }
+
+  // Check every reference once here so lookups don't have to
+  auto const* const files = GetTable<FileEntry>(*file, header.files_offset);
+  for (auto i = 0; i < header.file_count; ++i) {
+    if (files[i].name_offset > header.strings_size ||
+        files[i].name_size > header.strings_size - files[i].name_offset) {
+      return nullptr;
+    }
+  }
+  auto const* const rooms = GetTable<RoomEntry>(*file, header.rooms_offset);
+  for (auto i = 0; i < header.room_count; ++i) {
+    if (rooms[i].file >= header.file_count ||
+        rooms[i].name_offset > header.strings_size ||
+        rooms[i].name_size > header.strings_size - rooms[i].name_offset) {
+      return nullptr;
+    }
+  }
+  auto const* const keys = GetTable<KeyEntry>(*file, header.keys_offset);
+  for (auto i = 0; i < header.key_count; ++i) {
+    if ((i > 0 && keys[i].key <= keys[i - 1].key) ||
+        keys[i].first > header.posting_count ||
+        keys[i].count > header.posting_count - keys[i].first) {
+      return nullptr;
+    }
+  }
+  auto const* const postings =
+      GetTable<uint32_t>(*file, header.postings_offset);
+  for (auto i = 0; i < header.posting_count; ++i) {
+    if (postings[i] >= header.room_count) {
+      return nullptr;
+    }
+  }
+
+  return std::unique_ptr<RoomIndex>(new RoomIndex(std::move(file)));
+}
+
+auto RoomIndex::Find(IndexTerm term, uint32_t value) const -> PostingList {
+  auto const header = GetHeader(*file_);
+  auto const* const keys = GetTable<KeyEntry>(*file_, header.keys_offset);
+  auto const* const keys_end = keys + header.key_count;
+  auto const key = MakeKey(term, value);
+  auto const* const found = std::lower_bound(
+      keys, keys_end, key,
+      [](KeyEntry const& entry, uint64_t key) { return entry.key < key; });
+  if (found == keys_end || found->key != key) {
+    return {};
+  }
+  auto const* const postings =
+      GetTable<uint32_t>(*file_, header.postings_offset);
+  return PostingList{postings + found->first, found->count};
+}
+
+std::vector<uint32_t> RoomIndex::FindName(std::string const& text) const {
+  auto const needle = ToLower(text);
+
+  std::vector<uint32_t> candidates;
+  if (needle.size() < 3) {
+    // Too short for a trigram, so every room is a candidate
+    candidates.resize(GetRoomCount());
+    for (auto i = 0; i < candidates.size(); ++i) {
+      candidates[i] = i;
+    }
+  } else {
+    auto const first = Find(IndexTerm::trigram, MakeTrigramTerm(&needle[0]));
+    candidates.assign(first.begin(), first.end());
+    for (auto c = 1; c + 3 <= needle.size() && !candidates.empty(); ++c) {
+      candidates = IntersectPostings(
+          candidates, Find(IndexTerm::trigram, MakeTrigramTerm(&needle[c])));
+    }
+  }
+
+  // Trigrams can all be present without being next to each other
+  std::vector<uint32_t> matches;
+  for (auto const room : candidates) {
+    if (ToLower(GetRoomName(room)).find(needle) != std::string::npos) {
+      matches.push_back(room);
+    }
+  }
+  return matches;
+}
+
+size_t RoomIndex::GetRoomCount() const {
+  return GetHeader(*file_).room_count;
+}
+
+room_ref_t RoomIndex::GetRoom(uint32_t global_room) const {
+  auto const header = GetHeader(*file_);
+  auto const& entry =
+      GetTable<RoomEntry>(*file_, header.rooms_offset)[global_room];
+  return room_ref_t{entry.file, entry.room};
+}
+
+std::string RoomIndex::GetRoomName(uint32_t global_room) const {
+  auto const header = GetHeader(*file_);
+  auto const& entry =
+      GetTable<RoomEntry>(*file_, header.rooms_offset)[global_room];
+  return std::string(
+      reinterpret_cast<char const*>(file_->data() + header.strings_offset +
+                                    entry.name_offset),
+      entry.name_size);
+}
+
+std::string RoomIndex::GetFilename(uint32_t file) const {
+  auto const header = GetHeader(*file_);
+  auto const& entry = GetTable<FileEntry>(*file_, header.files_offset)[file];
+  return std::string(
+      reinterpret_cast<char const*>(file_->data() + header.strings_offset +
+                                    entry.name_offset),
+      entry.name_size);
+}
+
+std::vector<uint32_t> IntersectPostings(std::vector<uint32_t> const& a,
+                                        RoomIndex::PostingList const& b) {
+  std::vector<uint32_t> both;
+  std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                        std::back_inserter(both));
+  return both;
+}
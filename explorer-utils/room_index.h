@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "file.h"
+#include "room.h"
+
+/// Bumped whenever the on-disk layout changes. Indices with another version
+/// are rejected on open.
+constexpr uint32_t kRoomIndexVersion = 1;
+
+/// What a posting list is keyed by.
+enum class IndexTerm : uint32_t {
+  /// Raw room_t::tiles value
+  tile = 1,
+  /// room_t::objects value
+  object = 2,
+  /// room_t::monster_id, only for rooms with monsters
+  monster = 3,
+  /// `MakeAdjacentTerm(tile, object)`: the object is in a cell above, below,
+  /// left or right of the tile
+  adjacent = 4,
+  /// `MakeTrigramTerm(...)`: three consecutive characters of the lowercased
+  /// room name
+  trigram = 5,
+};
+
+constexpr uint32_t MakeAdjacentTerm(uint8_t tile, uint8_t object) {
+  return static_cast<uint32_t>(tile) << 8 | object;
+}
+
+/// `text` must have at least three characters; only the first three are used.
+uint32_t MakeTrigramTerm(char const* text);
+
+/// A room in one of the indexed files.
+struct room_ref_t {
+  uint32_t file;
+  /// Position in the file, same as in `LoadRooms`
+  uint32_t room;
+};
+
+/// Collects rooms from many RMS files and writes an inverted index over them.
+///
+/// Every room gets a global number, in the order files and rooms were added.
+/// Posting lists are sorted global numbers so that lists can be intersected
+/// by merging.
+class RoomIndexWriter {
+ public:
+  void AddFile(std::string const& filename, std::vector<room_t> const& rooms);
+
+  /// Throws std::runtime_error on I/O failure.
+  void Write(std::string const& filename) const;
+
+ private:
+  std::vector<std::string> filenames_;
+  std::vector<room_ref_t> rooms_;
+  std::vector<std::string> room_names_;
+  // (key, global room number), sorted and made unique on write
+  std::vector<std::pair<uint64_t, uint32_t>> postings_;
+};
+
+/// Memory-mapped index written by `RoomIndexWriter`.
+class RoomIndex {
+ public:
+  /// Points into the mapping. Valid for the lifetime of the index.
+  struct PostingList {
+    uint32_t const* data = nullptr;
+    size_t size = 0;
+
+    uint32_t const* begin() const { return data; }
+    uint32_t const* end() const { return data + size; }
+  };
+
+  /// Returns null if the file doesn't exist, has a different version, or is
+  /// malformed.
+  static std::unique_ptr<RoomIndex> Open(std::string const& filename);
+
+  /// Global numbers of the rooms with `term`, in increasing order.
+  PostingList Find(IndexTerm term, uint32_t value) const;
+
+  /// Rooms whose name contains `text`, ignoring case. Trigrams narrow it down
+  /// and the stored names confirm it.
+  std::vector<uint32_t> FindName(std::string const& text) const;
+
+  size_t GetRoomCount() const;
+  room_ref_t GetRoom(uint32_t global_room) const;
+  std::string GetRoomName(uint32_t global_room) const;
+  std::string GetFilename(uint32_t file) const;
+
+ private:
+  explicit RoomIndex(std::unique_ptr<MappedFile> file);
+
+  std::unique_ptr<MappedFile> file_;
+};
+
+/// Rooms in both sorted lists.
+std::vector<uint32_t> IntersectPostings(std::vector<uint32_t> const& a,
+                                        RoomIndex::PostingList const& b);
@@ -0,0 +1,208 @@
+#include "room_reach.h"
+
+#include "object.h"
+#include "tile.h"
+
+namespace {
+
+constexpr uint8_t kStairsUpTile = 32;
+constexpr uint8_t kStairsDownTile = 33;
+constexpr uint8_t kOddDesignTile = 56;
+
+/// Cells holding `tile`.
+RoomBitboard FindTile(room_t const& room, uint8_t tile) {
+  RoomBitboard cells{};
+  for (auto y = 0; y < kRoomHeight; ++y) {
+    for (auto x = 0; x < kRoomWidth; ++x) {
+      if (room.tiles[y * kRoomWidth + x] == tile) {
+        cells[y] |= 1u << x;
+      }
+    }
+  }
+  return cells;
+}
+
+bool IsEmpty(RoomBitboard const& cells) {
+  for (auto const row : cells) {
+    if (row != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Intersects(RoomBitboard const& a, RoomBitboard const& b) {
+  for (auto y = 0; y < kRoomHeight; ++y) {
+    if ((a[y] & b[y]) != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool IsObjectPassable(uint8_t object, reach_options_t const& options) {
+  switch (object) {
+    case 'h':
+    case 'i':
+      return options.open_doors;
+    case 'k':
+    case 'l':
+    case 'm':
+      return options.break_soft_walls;
+    case 'g':
+    case 'r':
+      return options.pass_blocks;
+  }
+  // Monsters can be fought, so they only hold the player up
+  auto const& info = GetObjectInfo(object);
+  return info.is_monster || info.passable;
+}
+
+}  // namespace
+
+RoomBitboard GetWalkableCells(room_t const& room,
+                              reach_options_t const& options) {
+  RoomBitboard cells{};
+  for (auto y = 0; y < kRoomHeight; ++y) {
+    for (auto x = 0; x < kRoomWidth; ++x) {
+      auto const index = y * kRoomWidth + x;
+      if (GetTileInfo(room.tiles[index]).walkable &&
+          IsObjectPassable(room.objects[index], options)) {
+        cells[y] |= 1u << x;
+      }
+    }
+  }
+  return cells;
+}
+
+RoomBitboard FloodFill(RoomBitboard const& start,
+                       RoomBitboard const& walkable) {
+  RoomBitboard reached;
+  for (auto y = 0; y < kRoomHeight; ++y) {
+    reached[y] = start[y] & walkable[y];
+  }
+
+  // Every pass grows each row sideways as far as it goes, then one step up
+  // and down. Open rooms settle in a handful of passes.
+  auto changed = true;
+  while (changed) {
+    changed = false;
+    for (auto y = 0; y < kRoomHeight; ++y) {
+      auto row = reached[y];
+      if (y > 0) {
+        row |= reached[y - 1];
+      }
+      if (y < kRoomHeight - 1) {
+        row |= reached[y + 1];
+      }
+      row &= walkable[y];
+      for (;;) {
+        auto const grown =
+            (row | row << 1 | row >> 1) & walkable[y] & kRoomRowMask;
+        if (grown == row) {
+          break;
+        }
+        row = grown;
+      }
+      if (row != reached[y]) {
+        reached[y] = row;
+        changed = true;
+      }
+    }
+  }
+  return reached;
+}
+
+RoomBitboard GetEntryCells(room_t const& room, RoomExit exit) {
+  RoomBitboard cells{};
+  switch (exit) {
+    case kExitNorth:
+      cells[0] = kRoomRowMask;
+      break;
+    case kExitSouth:
+      cells[kRoomHeight - 1] = kRoomRowMask;
+      break;
+    case kExitEast:
+      for (auto& row : cells) {
+        row = 1u << (kRoomWidth - 1);
+      }
+      break;
+    case kExitWest:
+      for (auto& row : cells) {
+        row = 1u;
+      }
+      break;
+    // Coming down from the room above arrives on the stairs up, and vice
+    // versa
+    case kExitUp:
+      cells = FindTile(room, kStairsUpTile);
+      break;
+    case kExitDown:
+      cells = FindTile(room, kStairsDownTile);
+      break;
+    default:
+      break;
+  }
+  return cells;
+}
+
+bool HasExit(room_t const& room, RoomExit exit) {
+  switch (exit) {
+    case kExitNorth:
+      return room.nav.north != 0;
+    case kExitEast:
+      return room.nav.east != 0;
+    case kExitSouth:
+      return room.nav.south != 0;
+    case kExitWest:
+      return room.nav.west != 0;
+    case kExitUp:
+      return room.nav.up != 0;
+    case kExitDown:
+      return room.nav.down != 0;
+    case kExitTeleport:
+      return !IsEmpty(FindTile(room, kOddDesignTile));
+    default:
+      return false;
+  }
+}
+
+uint8_t GetReachableExits(room_t const& room, RoomBitboard const& cells) {
+  auto any_column = 0u;
+  for (auto const row : cells) {
+    any_column |= row;
+  }
+
+  std::array<bool, kNumRoomExits> const reached = {
+      cells[0] != 0,
+      (any_column & 1u << (kRoomWidth - 1)) != 0,
+      cells[kRoomHeight - 1] != 0,
+      (any_column & 1u) != 0,
+      Intersects(cells, FindTile(room, kStairsUpTile)),
+      Intersects(cells, FindTile(room, kStairsDownTile)),
+      Intersects(cells, FindTile(room, kOddDesignTile)),
+  };
+
+  uint8_t exits = 0;
+  for (auto exit = 0; exit < kNumRoomExits; ++exit) {
+    if (reached[exit] && HasExit(room, static_cast<RoomExit>(exit))) {
+      exits |= 1 << exit;
+    }
+  }
+  return exits;
+}
+
+room_reach_t GetRoomReach(room_t const& room, reach_options_t const& options) {
+  auto const walkable = GetWalkableCells(room, options);
+
+  room_reach_t reach;
+  for (auto exit = 0; exit < kNumRoomExits; ++exit) {
+    auto const start = GetEntryCells(room, static_cast<RoomExit>(exit));
+    if (IsEmpty(start)) {
+      continue;
+    }
+    reach.exits[exit] =
+        GetReachableExits(room, FloodFill(start, walkable));
+  }
+  return reach;
+}
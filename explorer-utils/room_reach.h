@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "room.h"
+
+/// One bit per cell: bit `x` of row `y` is cell (x, y).
+using RoomBitboard = std::array<uint32_t, kRoomHeight>;
+
+constexpr uint32_t kRoomRowMask = (1u << kRoomWidth) - 1;
+
+/// Ways into and out of a room. Edges and stairs lead to the rooms in
+/// room_t::nav; the teleport is an odd design tile and is only ever an exit.
+enum RoomExit : int {
+  kExitNorth,
+  kExitEast,
+  kExitSouth,
+  kExitWest,
+  kExitUp,
+  kExitDown,
+  kExitTeleport,
+  kNumRoomExits,
+};
+
+/// Which obstacles the player is assumed to get through.
+struct reach_options_t {
+  /// Doors ('h', 'i'), assuming the player has keys
+  bool open_doors = true;
+  /// Soft walls and rubble ('k', 'l', 'm'), which break when attacked
+  bool break_soft_walls = true;
+  /// Movable blocks ('g', 'r'). Pushing can block other paths, so treating
+  /// them as passable is optimistic and treating them as walls is pessimistic
+  bool pass_blocks = false;
+};
+
+struct room_reach_t {
+  /// Indexed by the exit the player came in through: a mask of
+  /// `1 << RoomExit` for every exit they can leave by. Only exits that lead
+  /// somewhere (non-zero room_t::nav, a teleport tile) are included
+  std::array<uint8_t, kNumRoomExits> exits{};
+
+  bool CanReach(RoomExit from, RoomExit to) const {
+    return (exits[from] >> to & 1) != 0;
+  }
+};
+
+/// Whether `exit` leads anywhere: a non-zero room_t::nav entry, or for the
+/// teleport, an odd design tile.
+bool HasExit(room_t const& room, RoomExit exit);
+
+/// Cells the player can stand on.
+RoomBitboard GetWalkableCells(room_t const& room,
+                              reach_options_t const& options = {});
+
+/// Every cell of `walkable` connected to `start` by steps up, down, left or
+/// right. Cells of `start` that aren't walkable are ignored.
+RoomBitboard FloodFill(RoomBitboard const& start,
+                       RoomBitboard const& walkable);
+
+/// Cells where the player appears when entering through this room's own
+/// `exit`: the matching edge, or the stairs themselves, so coming down from
+/// the room above is kExitUp. Empty for the teleport.
+RoomBitboard GetEntryCells(room_t const& room, RoomExit exit);
+
+/// Mask of `1 << RoomExit` for the exits reachable from `cells`.
+uint8_t GetReachableExits(room_t const& room, RoomBitboard const& cells);
+
+room_reach_t GetRoomReach(room_t const& room,
+                          reach_options_t const& options = {});
@@ -0,0 +1,38 @@
+#include "room_render.h"
+
+#include <stdexcept>
+
+using namespace std::string_literals;
+
+unsigned ParseRenderModes(std::string const& name) {
+  unsigned modes = kRenderNormal;
+  size_t start = 0;
+  while (start <= name.size()) {
+    auto end = name.find('+', start);
+    if (end == std::string::npos) {
+      end = name.size();
+    }
+    auto const mode = name.substr(start, end - start);
+    if (mode == "normal") {
+      // Nothing to add
+    } else if (mode == "all") {
+      modes |= kRenderAll;
+    } else if (mode == "glass") {
+      modes |= kRenderGlass;
+    } else if (mode == "nodark") {
+      modes |= kRenderNoDarkness;
+    } else if (mode == "traps") {
+      modes |= kRenderTraps;
+    } else if (mode == "soft") {
+      modes |= kRenderSoftWalls;
+    } else if (mode == "quasits") {
+      modes |= kRenderQuasits;
+    } else if (mode == "threat") {
+      modes |= kRenderThreat;
+    } else {
+      throw std::invalid_argument("Unknown render mode: "s + mode);
+    }
+    start = end + 1;
+  }
+  return modes;
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "color.h"
+#include "image.h"
+#include "monster.h"
+#include "room.h"
+#include "stats.h"
+#include "threat.h"
+#include "trap.h"
+
+/// Cheats that reveal what the game hides, combined as bit flags. Every
+/// combination is compiled into its own render loop, so modes that are off
+/// cost nothing.
+enum RenderMode : unsigned {
+  kRenderNormal = 0,
+  /// Tint glass walls and movable glass blocks, which look like floor
+  kRenderGlass = 1 << 0,
+  /// Don't draw magical darkness over what it hides
+  kRenderNoDarkness = 1 << 1,
+  /// Outline traps, in a different color for each kind (see `GetTrapColor`)
+  kRenderTraps = 1 << 2,
+  /// Tint soft walls and secret doors, which look like any other wall
+  kRenderSoftWalls = 1 << 3,
+  /// Outline Quasits
+  kRenderQuasits = 1 << 4,
+  /// Every cheat above
+  kRenderAll = (1 << 5) - 1,
+  /// Not a cheat: shade cells by how dangerous they are (see `ThreatMap`)
+  kRenderThreat = 1 << 5,
+  kNumRenderModes = 1 << 6,
+};
+
+/// Accepts mode names joined by '+' (e.g. "glass+traps"). Mode names are
+/// normal, all (every cheat), glass, nodark, traps, soft, quasits and threat.
+/// Throws std::invalid_argument for anything else.
+unsigned ParseRenderModes(std::string const& name);
+
+/// Draws rooms one row of cells at a time (see `ImageSink`). `Spritesheet` can
+/// be anything that can be indexed for something blittable: LazySpritesheet,
+/// SpriteArena, SpriteArenaView. The spritesheets and monster data must
+/// outlive the renderer.
+template <typename Spritesheet>
+class RoomRenderer {
+ public:
+  RoomRenderer(Spritesheet const& tiles, Spritesheet const& monsters,
+               Spritesheet const& monster_masks,
+               std::vector<monster_t> const& monster_data, int scale = 1)
+      : tiles_(tiles),
+        monsters_(monsters),
+        monster_masks_(monster_masks),
+        monster_data_(monster_data),
+        scale_(scale),
+        cell_width_(GetFirstTile(tiles).GetWidth() * scale),
+        cell_height_(GetFirstTile(tiles).GetHeight() * scale) {}
+
+  /// Indexed by room_t::monster_id. Monsters marked true are outlined by
+  /// kRenderQuasits.
+  void SetQuasits(std::vector<bool> quasits) { quasits_ = std::move(quasits); }
+
+  /// Threat of the room about to be rendered, for kRenderThreat. Cells shade
+  /// from clear at 0 to fully tinted at `saturation`. `map` must outlive
+  /// every `RenderRow` call that uses it.
+  void SetThreatMap(ThreatMap const* map, float saturation) {
+    threat_map_ = map;
+    threat_saturation_ = saturation;
+  }
+
+  int GetCellWidth() const { return cell_width_; }
+  int GetCellHeight() const { return cell_height_; }
+  int GetRoomWidth() const { return cell_width_ * kRoomWidth; }
+  int GetRoomHeight() const { return cell_height_ * kRoomHeight; }
+
+  /// Draws row `y` of `room` into `strip`, which must be `GetRoomWidth()` by
+  /// `GetCellHeight()`. Every cell is drawn over, empty ones in black, so one
+  /// strip can be reused for every row.
+  template <unsigned Modes>
+  void RenderRow(room_t const& room, int y, Image& strip) const {
+    for (auto x = 0; x < kRoomWidth; ++x) {
+      RenderCell<Modes>(room, x, y, strip);
+    }
+  }
+
+  /// Same as above but with modes only known at runtime.
+  void RenderRow(room_t const& room, int y, unsigned modes,
+                 Image& strip) const {
+    STATS_TIMER("render rooms");
+    static constexpr auto dispatch =
+        MakeDispatch(std::make_index_sequence<kNumRenderModes>());
+    (this->*dispatch[modes % kNumRenderModes])(room, y, strip);
+  }
+
+ private:
+  using RowFunction = void (RoomRenderer::*)(room_t const&, int,
+                                             Image&) const;
+
+  template <size_t... Modes>
+  static constexpr std::array<RowFunction, sizeof...(Modes)> MakeDispatch(
+      std::index_sequence<Modes...>) {
+    return {&RoomRenderer::RenderRow<Modes>...};
+  }
+
+  /// Cells are sized after the first tile, so there must be one.
+  static decltype(auto) GetFirstTile(Spritesheet const& tiles) {
+    if (tiles.empty()) {
+      throw std::invalid_argument("RoomRenderer needs at least one tile");
+    }
+    return tiles[0];
+  }
+
+  template <unsigned Modes>
+  void RenderCell(room_t const& room, int x, int y, Image& strip) const {
+    auto const cell_x = x * cell_width_;
+    auto const index = y * kRoomWidth + x;
+
+    // FIRST do tile
+    auto const& trap = GetTrapInfo(room.tiles[index]);
+    auto tile = trap.tile;
+
+    // 0 is null, nothing here
+    if (tile == 0) {
+      strip.Fill(cell_x, 0, cell_width_, cell_height_, color_t{0, 0, 0});
+      return;
+    }
+    tile -= 1;
+
+    // Spritesheets that are too short still get something drawn
+    if (tile >= tiles_.size()) {
+      tile = kTrapTile - 1;
+    }
+    if (tile >= tiles_.size()) {
+      strip.Fill(cell_x, 0, cell_width_, cell_height_, color_t{0, 0, 0});
+      return;
+    }
+
+    strip.Blit(tiles_[tile], cell_x, 0, scale_);
+
+    // SECOND do object
+    auto const object = room.objects[index];
+    if (!(Modes & kRenderNoDarkness) || object != 'd') {
+      RenderObject(room, object, cell_x, strip);
+    }
+
+    // LAST do cheats
+    if constexpr ((Modes & kRenderGlass) != 0) {
+      if (room.tiles[index] == kGlassWallTile || object == 'r') {
+        strip.Tint(cell_x, 0, cell_width_, cell_height_, kGlassColor);
+      }
+    }
+    if constexpr ((Modes & kRenderSoftWalls) != 0) {
+      if (room.tiles[index] == kSecretDoorTile || object == 'k' ||
+          object == 'l' || object == 'm') {
+        strip.Tint(cell_x, 0, cell_width_, cell_height_, kSoftWallColor);
+      }
+    }
+    if constexpr ((Modes & kRenderThreat) != 0) {
+      RenderThreat(index, cell_x, strip);
+    }
+    if constexpr ((Modes & kRenderTraps) != 0) {
+      if (trap.kind != trap_kind::none) {
+        strip.Outline(cell_x, 0, cell_width_, cell_height_,
+                      GetTrapColor(trap), scale_);
+      }
+    }
+    if constexpr ((Modes & kRenderQuasits) != 0) {
+      if (GetObjectInfo(object).is_monster &&
+          room.monster_id < quasits_.size() &&
+          quasits_[room.monster_id]) {
+        strip.Outline(cell_x, 0, cell_width_, cell_height_, kQuasitColor,
+                      scale_);
+      }
+    }
+  }
+
+  void RenderThreat(int index, int cell_x, Image& strip) const {
+    if (threat_map_ == nullptr || threat_saturation_ <= 0) {
+      return;
+    }
+    auto const level =
+        std::min((*threat_map_)[index] / threat_saturation_, 1.0f);
+    auto const alpha = static_cast<uint8_t>(level * kMaxThreatAlpha);
+    if (alpha != 0) {
+      strip.Blend(cell_x, 0, cell_width_, cell_height_, kThreatColor, alpha);
+    }
+  }
+
+  void RenderObject(room_t const& room, uint8_t object, int cell_x,
+                    Image& strip) const {
+    // 0 is null, nothing here
+    if (object == 0) {
+      return;
+    }
+
+    auto const& info = GetObjectInfo(object);
+
+    // Monsters (with mask)
+    if (info.is_monster) {
+      // Both are 1-based, and nothing is drawn for broken references
+      auto const monster_index = room.monster_id - 1;
+      if (monster_index < 0 || monster_index >= monster_data_.size()) {
+        return;
+      }
+      auto const monster_gfx = monster_data_[monster_index].gfx - 1;
+      if (monster_gfx < 0 || monster_gfx >= monsters_.size() ||
+          monster_gfx >= monster_masks_.size()) {
+        return;
+      }
+      strip.Blit(monsters_[monster_gfx], monster_masks_[monster_gfx], cell_x,
+                 0, scale_);
+      return;
+    }
+
+    if (info.tile >= tiles_.size() || info.mask >= tiles_.size()) {
+      return;
+    }
+
+    // Tiles no mask
+    if (info.mask == 0) {
+      strip.Blit(tiles_[info.tile], cell_x, 0, scale_);
+      return;
+    }
+
+    // Tiles with mask
+    strip.Blit(tiles_[info.tile], tiles_[info.mask], cell_x, 0, scale_);
+  }
+
+  // Raw values of room_t::tiles
+  static constexpr uint8_t kGlassWallTile = 35;
+  static constexpr uint8_t kSecretDoorTile = 46;
+
+  static constexpr auto kGlassColor = color_t{0x55, 0xFF, 0xFF};
+  static constexpr auto kSoftWallColor = color_t{0xFF, 0xFF, 0x55};
+  static constexpr auto kQuasitColor = color_t{0xFF, 0x55, 0xFF};
+  static constexpr auto kThreatColor = color_t{0xFF, 0x00, 0x00};
+  // Keep what's underneath visible even in the most dangerous cells
+  static constexpr auto kMaxThreatAlpha = 160;
+
+  Spritesheet const& tiles_;
+  Spritesheet const& monsters_;
+  Spritesheet const& monster_masks_;
+  std::vector<monster_t> const& monster_data_;
+  int scale_;
+  int cell_width_;
+  int cell_height_;
+  std::vector<bool> quasits_;
+  ThreatMap const* threat_map_ = nullptr;
+  float threat_saturation_ = 0;
+};
@@ -0,0 +1,187 @@
+#include "room_similarity.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <tuple>
+#include <utility>
+
+namespace {
+
+constexpr auto kRowsPerBand = kMinHashSize / kLshBands;
+
+/// splitmix64 finalizer, spreads every input bit over the output.
+constexpr uint64_t Mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EB;
+  x ^= x >> 31;
+  return x;
+}
+
+/// Hash function `i` is `(multipliers[i] * h + offsets[i]) >> 32` of the
+/// mixed cell `h`, which is much cheaper than mixing once per function.
+struct HashFamily {
+  std::array<uint64_t, kMinHashSize> multipliers;
+  std::array<uint64_t, kMinHashSize> offsets;
+};
+
+constexpr HashFamily kHashFamily = [] {
+  HashFamily family{};
+  for (auto i = 0; i < kMinHashSize; ++i) {
+    // Odd multipliers so no information is lost
+    family.multipliers[i] = Mix(2 * i + 1) | 1;
+    family.offsets[i] = Mix(2 * i + 2);
+  }
+  return family;
+}();
+
+uint64_t HashBand(MinHashSignature const& signature, int band) {
+  uint64_t hash = band;
+  for (auto row = 0; row < kRowsPerBand; ++row) {
+    hash = Mix(hash ^ signature[band * kRowsPerBand + row]);
+  }
+  return hash;
+}
+
+int CountEqualCells(room_t const& a, room_t const& b) {
+  auto same = 0;
+  for (auto i = 0; i < kRoomArea; ++i) {
+    same += a.tiles[i] == b.tiles[i] && a.objects[i] == b.objects[i];
+  }
+  return same;
+}
+
+}  // namespace
+
+MinHashSignature GetMinHashSignature(room_t const& room) {
+  MinHashSignature signature;
+  signature.fill(std::numeric_limits<uint32_t>::max());
+  for (auto i = 0; i < kRoomArea; ++i) {
+    auto const cell = Mix(static_cast<uint64_t>(i) << 16 |
+                          static_cast<uint64_t>(room.tiles[i]) << 8 |
+                          room.objects[i]);
+    for (auto h = 0; h < kMinHashSize; ++h) {
+      auto const value = static_cast<uint32_t>(
+          (kHashFamily.multipliers[h] * cell + kHashFamily.offsets[h]) >>
+          32);
+      signature[h] = std::min(signature[h], value);
+    }
+  }
+  return signature;
+}
+
+double GetRoomSimilarity(room_t const& a, room_t const& b) {
+  return static_cast<double>(CountEqualCells(a, b)) / kRoomArea;
+}
+
+std::vector<room_match_t> FindSimilarRooms(std::vector<room_t> const& rooms,
+                                           double min_similarity) {
+  std::vector<MinHashSignature> signatures;
+  signatures.reserve(rooms.size());
+  for (auto const& room : rooms) {
+    signatures.push_back(GetMinHashSignature(room));
+  }
+
+  // Rooms with exactly the same cells (e.g. untouched templates) share one
+  // representative, so a pile of copies can't flood the buckets below. Their
+  // signatures are equal too, so comparing those first keeps sorting cheap.
+  std::vector<uint32_t> order(rooms.size());
+  for (uint32_t i = 0; i < rooms.size(); ++i) {
+    order[i] = i;
+  }
+  auto const same_cells = [&rooms](uint32_t a, uint32_t b) {
+    return rooms[a].tiles == rooms[b].tiles &&
+           rooms[a].objects == rooms[b].objects;
+  };
+  std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return std::tie(signatures[a], rooms[a].tiles, rooms[a].objects, a) <
+           std::tie(signatures[b], rooms[b].tiles, rooms[b].objects, b);
+  });
+  // Members of each group in ascending order, the first is the representative
+  std::vector<std::vector<uint32_t>> groups;
+  for (size_t i = 0; i < order.size(); ++i) {
+    if (i == 0 || !same_cells(order[i - 1], order[i])) {
+      groups.emplace_back();
+    }
+    groups.back().push_back(order[i]);
+  }
+
+  // Sorting (band hash, group) puts every bucket in a contiguous run. Pairs
+  // of groups are deduplicated band by band so that only distinct pairs pile
+  // up.
+  std::vector<std::pair<uint32_t, uint32_t>> candidates;
+  std::vector<std::pair<uint32_t, uint32_t>> band_candidates;
+  std::vector<std::pair<uint32_t, uint32_t>> merged;
+  std::vector<std::pair<uint64_t, uint32_t>> buckets(groups.size());
+  for (auto band = 0; band < kLshBands; ++band) {
+    for (uint32_t g = 0; g < groups.size(); ++g) {
+      buckets[g] = {HashBand(signatures[groups[g].front()], band), g};
+    }
+    std::sort(buckets.begin(), buckets.end());
+    band_candidates.clear();
+    for (size_t start = 0; start < buckets.size();) {
+      auto end = start + 1;
+      while (end < buckets.size() &&
+             buckets[end].first == buckets[start].first) {
+        ++end;
+      }
+      for (auto i = start; i < end; ++i) {
+        for (auto j = i + 1; j < end; ++j) {
+          band_candidates.emplace_back(buckets[i].second, buckets[j].second);
+        }
+      }
+      start = end;
+    }
+    // Within a bucket groups are in ascending order, so pairs already are
+    std::sort(band_candidates.begin(), band_candidates.end());
+    merged.clear();
+    std::set_union(candidates.begin(), candidates.end(),
+                   band_candidates.begin(), band_candidates.end(),
+                   std::back_inserter(merged));
+    candidates.swap(merged);
+  }
+
+  // Expand pairs of groups back to pairs of rooms
+  std::vector<room_match_t> matches;
+  if (min_similarity <= 1) {
+    for (auto const& group : groups) {
+      for (size_t i = 0; i < group.size(); ++i) {
+        for (auto j = i + 1; j < group.size(); ++j) {
+          matches.push_back(room_match_t{group[i], group[j], 1});
+        }
+      }
+    }
+  }
+  for (auto const& [group_a, group_b] : candidates) {
+    auto const similarity = GetRoomSimilarity(rooms[groups[group_a].front()],
+                                              rooms[groups[group_b].front()]);
+    if (similarity < min_similarity) {
+      continue;
+    }
+    for (auto const a : groups[group_a]) {
+      for (auto const b : groups[group_b]) {
+        matches.push_back(
+            room_match_t{std::min(a, b), std::max(a, b), similarity});
+      }
+    }
+  }
+  std::sort(matches.begin(), matches.end(), [](auto const& x, auto const& y) {
+    return std::tie(x.a, x.b) < std::tie(y.a, y.b);
+  });
+  return matches;
+}
+
+std::vector<cell_diff_t> DiffRooms(room_t const& a, room_t const& b) {
+  std::vector<cell_diff_t> diffs;
+  for (auto i = 0; i < kRoomArea; ++i) {
+    if (a.tiles[i] != b.tiles[i] || a.objects[i] != b.objects[i]) {
+      diffs.push_back(cell_diff_t{static_cast<uint8_t>(i % kRoomWidth),
+                                  static_cast<uint8_t>(i / kRoomWidth),
+                                  a.tiles[i], b.tiles[i], a.objects[i],
+                                  b.objects[i]});
+    }
+  }
+  return diffs;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "room.h"
+
+/// Number of hash functions in a MinHash signature.
+constexpr auto kMinHashSize = 64;
+/// Signatures are split into this many bands for locality-sensitive hashing.
+/// Two rooms become candidates if any band matches exactly.
+constexpr auto kLshBands = 16;
+static_assert(kMinHashSize % kLshBands == 0);
+
+/// MinHash of the set of (position, tile, object) cells of a room. The
+/// fraction of matching entries between two signatures estimates the Jaccard
+/// similarity of their cell sets.
+using MinHashSignature = std::array<uint32_t, kMinHashSize>;
+
+MinHashSignature GetMinHashSignature(room_t const& room);
+
+/// Fraction of cells with the same tile and object in both rooms, 0 to 1.
+double GetRoomSimilarity(room_t const& a, room_t const& b);
+
+struct room_match_t {
+  /// Indices into the rooms that were searched, `a` < `b`
+  uint32_t a;
+  uint32_t b;
+  /// See `GetRoomSimilarity`
+  double similarity;
+};
+
+/// Pairs of rooms at least `min_similarity` alike, sorted by `a` then `b`.
+/// Exact copies are collapsed first and only pairs sharing an LSH band are
+/// compared, so this is roughly linear in the number of rooms as long as few
+/// distinct rooms are alike. It does become quadratic for a big cluster of
+/// rooms that are alike but not identical, and every pair of copies is still
+/// returned, so n copies of one room give n * (n - 1) / 2 matches. Pairs at
+/// least 0.9 alike are practically always found, 0.8 about 97% of the time,
+/// and less alike pairs are increasingly likely to be missed.
+std::vector<room_match_t> FindSimilarRooms(std::vector<room_t> const& rooms,
+                                           double min_similarity);
+
+struct cell_diff_t {
+  uint8_t x;
+  uint8_t y;
+  uint8_t tile_a;
+  uint8_t tile_b;
+  uint8_t object_a;
+  uint8_t object_b;
+};
+
+/// Every cell whose tile or object differs between the two rooms.
+std::vector<cell_diff_t> DiffRooms(room_t const& a, room_t const& b);
@@ -0,0 +1,34 @@
+#include "sprite_arena.h"
+
+#include <algorithm>
+#include <memory>
+#include <new>
+
+namespace {
+
+/// Rounds the sprite size up so that every sprite stays aligned. color_t is 3
+/// bytes so this is a multiple of `kSpriteArenaAlignment` pixels.
+size_t AlignedSpriteStride(int width, int height) {
+  auto const area = static_cast<size_t>(width) * height;
+  return (area + kSpriteArenaAlignment - 1) / kSpriteArenaAlignment *
+         kSpriteArenaAlignment;
+}
+
+}  // namespace
+
+SpriteArena::SpriteArena(size_t count, int width, int height)
+    : count_(count),
+      width_(width),
+      height_(height),
+      sprite_stride_(AlignedSpriteStride(width, height)) {
+  auto const num_pixels = count_ * sprite_stride_;
+  auto* const pixels = static_cast<color_t*>(
+      ::operator new(std::max<size_t>(num_pixels, 1) * sizeof(color_t),
+                     std::align_val_t{kSpriteArenaAlignment}));
+  std::uninitialized_fill_n(pixels, num_pixels, color_black);
+  pixels_.reset(pixels);
+}
+
+void SpriteArena::AlignedDelete::operator()(color_t* pixels) const {
+  ::operator delete(pixels, std::align_val_t{kSpriteArenaAlignment});
+}
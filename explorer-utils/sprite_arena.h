@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "image.h"
+
+/// Every sprite in a `SpriteArena` starts on a boundary of this many bytes.
+constexpr auto kSpriteArenaAlignment = 64;
+
+/// Read-only view of sprites laid out like a `SpriteArena` but owned by
+/// something else, e.g. a memory-mapped `AssetCache`.
+class SpriteArenaView {
+ public:
+  SpriteArenaView(color_t const* pixels, size_t count, int width, int height,
+                  size_t sprite_stride)
+      : pixels_(pixels),
+        count_(count),
+        width_(width),
+        height_(height),
+        sprite_stride_(sprite_stride) {}
+
+  ImageView operator[](size_t index) const {
+    return ImageView(pixels_ + index * sprite_stride_, width_, height_,
+                     width_);
+  }
+
+  size_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+  int GetWidth() const { return width_; }
+  int GetHeight() const { return height_; }
+  size_t GetSpriteStride() const { return sprite_stride_; }
+  color_t const* GetData() const { return pixels_; }
+
+ private:
+  color_t const* pixels_;
+  size_t count_;
+  int width_;
+  int height_;
+  size_t sprite_stride_;
+};
+
+/// Fixed-size sprites stored back to back in a single aligned allocation, as
+/// opposed to `std::vector<Image>` which allocates once per sprite. The buffer
+/// has no pointers in it so it can be written to a file verbatim.
+class SpriteArena {
+ public:
+  SpriteArena() : SpriteArena(0, 0, 0) {}
+  SpriteArena(size_t count, int width, int height);
+
+  ImageView operator[](size_t index) const {
+    return ImageView(GetPixels(index), width_, height_, width_);
+  }
+
+  /// Mutable access to the first pixel of a sprite, for decoders.
+  color_t* GetPixels(size_t index) {
+    return pixels_.get() + index * sprite_stride_;
+  }
+  color_t const* GetPixels(size_t index) const {
+    return pixels_.get() + index * sprite_stride_;
+  }
+
+  size_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+  int GetWidth() const { return width_; }
+  int GetHeight() const { return height_; }
+  /// Distance between the start of consecutive sprites, in pixels.
+  size_t GetSpriteStride() const { return sprite_stride_; }
+  /// The whole buffer, `size() * GetSpriteStride()` pixels long.
+  color_t const* GetData() const { return pixels_.get(); }
+
+  operator SpriteArenaView() const {
+    return SpriteArenaView(pixels_.get(), count_, width_, height_,
+                           sprite_stride_);
+  }
+
+ private:
+  struct AlignedDelete {
+    void operator()(color_t* pixels) const;
+  };
+
+  size_t count_;
+  int width_;
+  int height_;
+  size_t sprite_stride_;
+  std::unique_ptr<color_t[], AlignedDelete> pixels_;
+};
@@ -1,9 +1,16 @@
 #include "spritesheet.h"
 
+#include <algorithm>
 #include <array>
 #include <cstring>
+#include <stdexcept>
+#include <utility>
 
 #include "file.h"
+#include "stats.h"
+#include "thread_pool.h"
+
+using namespace std::string_literals;
 
 namespace {
 
@@ -30,6 +37,9 @@ constexpr auto kEgaBitsPerPixel = 4;  // 16-color EGA nibble
 constexpr auto kEgaBytesPerRow = kCgaBytesPerRow * kEgaBitsPerPixel;
 constexpr auto kImageAlignmentInBytes = kCgaCellSizeInBytes * kEgaBitsPerPixel;
 
+// Sheets with fewer cells than this per job are decoded serially.
+constexpr auto kMinCellsPerJob = 256;
+
 auto constexpr cga_header = std::array<uint8_t, 4>{0x0E, 0x00, 0x0E, 0x00};
 auto constexpr ega_header = std::array<uint8_t, 4>{0x1D, 0x00, 0x0E, 0x00};
 
@@ -50,112 +60,250 @@ auto constexpr ega_palette = std::array<color_t, 16>{
     color_t{0xFF, 0x55, 0x55}, color_t{0xFF, 0x55, 0xFF},
     color_t{0xFF, 0xFF, 0x55}, color_t{0xFF, 0xFF, 0xFF}};
 
+bool HasHeader(std::vector<uint8_t> const& data,
+               std::array<uint8_t, 4> const& header) {
+  return data.size() >= header.size() &&
+         memcmp(data.data(), header.data(), header.size()) == 0;
+}
+
 /// Helper method to extract half-nibbles from a buffered byte.
 inline constexpr uint8_t HalfNibble(uint8_t const val, int const part) {
   return (val >> (part * 2)) & 0x3;
 }
 
-std::vector<Image> LoadCgaSpritesheet(std::vector<uint8_t> const& data) {
-  auto const num_images = data.size() / kImageAlignmentInBytes;
-  std::vector<Image> images(num_images, Image(kImageWidth, kImageHeight));
+/// Decodes one CGA cell starting at `cell`, calling `set(x, y, index)` with a
+/// `cga_palette` index for every pixel of the 15x15 image.
+template <typename SetPixel>
+void DecodeCgaCell(uint8_t const* cell, SetPixel&& set) {
+  // Ignore first full row (contains garbage)
+  for (auto y = 1; y < kCellHeight; ++y) {
+    for (auto x = 0; x < kCgaBytesPerRow; ++x) {
+      auto const b = cell[(y * kCgaBytesPerRow) + x];
 
-  for (auto image_index = 0; image_index < num_images; ++image_index) {
-    auto& image = images[image_index];
-    auto const image_offset = image_index * kImageAlignmentInBytes;
+      // (y - 1) to compensate for ignoring the first row
+      set(x * kCgaPixelsPerByte, y - 1, HalfNibble(b, 3));
+      set(x * kCgaPixelsPerByte + 1, y - 1, HalfNibble(b, 2));
+      set(x * kCgaPixelsPerByte + 2, y - 1, HalfNibble(b, 1));
 
-    // Ignore first full row (contains garbage)
-    for (auto y = 1; y < kCellHeight; ++y) {
-      for (auto x = 0; x < kCgaBytesPerRow; ++x) {
-        auto const byte_offset = image_offset + (y * kCgaBytesPerRow) + x;
-        auto const b = data[byte_offset];
+      // Last byte of row only contains 3 pixels (because final image
+      // is 15 wide, not 16 wide)
+      if (x != kCgaBytesPerRow - 1) {
+        set(x * kCgaPixelsPerByte + 3, y - 1, HalfNibble(b, 0));
+      }
+    }
+  }
+}
+
+/// Decodes one EGA cell starting at `cell`, calling `set(x, y, index)` with an
+/// `ega_palette` index for every pixel of the 15x15 image.
+template <typename SetPixel>
+void DecodeEgaCell(uint8_t const* cell, SetPixel&& set) {
+  for (auto y = 0; y < kCellHeight - 1; ++y) {
+    for (auto byte_column = 0; byte_column < kCgaBytesPerRow; ++byte_column) {
+      auto const byte_offset = (y * kEgaBytesPerRow) + byte_column;
+      auto const next_byte_offset = byte_offset + kEgaBytesPerRow;
 
-        // (y - 1) to compensate for ignoring the first row
-        image.Set(x * kCgaPixelsPerByte, y - 1, cga_palette[HalfNibble(b, 3)]);
-        image.Set(x * kCgaPixelsPerByte + 1, y - 1,
-                  cga_palette[HalfNibble(b, 2)]);
-        image.Set(x * kCgaPixelsPerByte + 2, y - 1,
-                  cga_palette[HalfNibble(b, 1)]);
+      for (auto halfnibble = 3; halfnibble >= 0; --halfnibble) {
+        // + kCgaBytesPerRow * X    to "stride" rows
+        // HalfNibble               to address a specific pixel
+        // / 2                      to convert data half-nibble to bit
+        // << Y                     to place bit in proper EGA index
+        auto const ega =
+            ((HalfNibble(cell[byte_offset + kCgaBytesPerRow * 1], halfnibble) /
+              2)
+             << 0x3) |
+            ((HalfNibble(cell[byte_offset + kCgaBytesPerRow * 2], halfnibble) /
+              2)
+             << 0x2) |
+            ((HalfNibble(cell[byte_offset + kCgaBytesPerRow * 3], halfnibble) /
+              2)
+             << 0x1) |
+            (HalfNibble(cell[next_byte_offset], halfnibble) / 2);
 
         // Last byte of row only contains 3 pixels (because final image
         // is 15 wide, not 16 wide)
-        if (x != kCgaBytesPerRow - 1) {
-          image.Set(x * kCgaPixelsPerByte + 3, y - 1,
-                    cga_palette[HalfNibble(b, 0)]);
+        auto const x = byte_column * kCgaBytesPerRow + (3 - halfnibble);
+        if (x < kImageWidth) {
+          set(x, y, static_cast<uint8_t>(ega));
         }
       }
     }
   }
-
-  return images;
 }
 
-std::vector<Image> LoadEgaSpritesheet(std::vector<uint8_t> const& data) {
-  auto const num_images = data.size() / kImageAlignmentInBytes;
-  std::vector<Image> images(num_images,
-                            Image(kImageWidth, kImageHeight));  // TODO 15x15
-
-  for (auto image_index = 0; image_index < num_images; ++image_index) {
-    auto& image = images[image_index];
-    auto const image_offset = image_index * kImageAlignmentInBytes;
-
-    for (auto y = 0; y < kCellHeight - 1; ++y) {
-      for (auto byte_column = 0; byte_column < kCgaBytesPerRow; ++byte_column) {
-        auto const byte_offset =
-            image_offset + (y * kEgaBytesPerRow) + byte_column;
-        auto const next_byte_offset = byte_offset + kEgaBytesPerRow;
-
-        for (auto halfnibble = 3; halfnibble >= 0; --halfnibble) {
-          // + kCgaBytesPerRow * X    to "stride" rows
-          // HalfNibble               to address a specific pixel
-          // / 2                      to convert data half-nibble to bit
-          // << Y                     to place bit in proper EGA index
-          auto const ega = ((HalfNibble(data[byte_offset + kCgaBytesPerRow * 1],
-                                        halfnibble) /
-                             2)
-                            << 0x3) |
-                           ((HalfNibble(data[byte_offset + kCgaBytesPerRow * 2],
-                                        halfnibble) /
-                             2)
-                            << 0x2) |
-                           ((HalfNibble(data[byte_offset + kCgaBytesPerRow * 3],
-                                        halfnibble) /
-                             2)
-                            << 0x1) |
-                           (HalfNibble(data[next_byte_offset], halfnibble) / 2);
-
-          // Last byte of row only contains 3 pixels (because final image
-          // is 15 wide, not 16 wide)
-          auto const x = byte_column * kCgaBytesPerRow + (3 - halfnibble);
-          if (x < kImageWidth) {
-            image.Set(x, y, ega_palette[ega]);
-          }
-        }
-      }
-    }
+/// Decoder and palette of each format, for `DecodeCells`.
+struct cga_format_t {
+  static constexpr auto const& palette = cga_palette;
+
+  template <typename SetPixel>
+  static void DecodeCell(uint8_t const* cell, SetPixel&& set) {
+    DecodeCgaCell(cell, std::forward<SetPixel>(set));
+  }
+};
+
+struct ega_format_t {
+  static constexpr auto const& palette = ega_palette;
+
+  template <typename SetPixel>
+  static void DecodeCell(uint8_t const* cell, SetPixel&& set) {
+    DecodeEgaCell(cell, std::forward<SetPixel>(set));
   }
+};
 
+/// Decodes every whole cell of `data`. `make_setter(i)` is called once per
+/// cell and returns the `set(x, y, color)` that stores image `i`'s pixels.
+/// Cells are independent, so big sheets are split into ranges for the thread
+/// pool.
+template <typename Format, typename MakeSetter>
+void DecodeCells(std::vector<uint8_t> const& data, MakeSetter&& make_setter) {
+  STATS_TIMER("decode sprites");
+  auto const num_images = data.size() / kImageAlignmentInBytes;
+  STATS_COUNT(kStatSpritesDecoded, num_images);
+
+  // A task costs more than decoding a few hundred cells, so small sheets
+  // (which is every sheet that ships with the game) stay serial.
+  ParallelFor(0, num_images, kMinCellsPerJob, [&](size_t image_index) {
+    auto set = make_setter(image_index);
+    Format::DecodeCell(data.data() + image_index * kImageAlignmentInBytes,
+                       [&set](int x, int y, uint8_t index) {
+                         set(x, y, Format::palette[index]);
+                       });
+  });
+}
+
+template <typename Format>
+std::vector<Image> DecodeImages(std::vector<uint8_t> const& data) {
+  std::vector<Image> images(data.size() / kImageAlignmentInBytes,
+                            Image(kImageWidth, kImageHeight));
+  DecodeCells<Format>(data, [&images](size_t index) {
+    return [&image = images[index]](int x, int y, color_t const& color) {
+      image.Set(x, y, color);
+    };
+  });
   return images;
 }
 
+template <typename Format>
+SpriteArena DecodeSpriteArena(std::vector<uint8_t> const& data) {
+  SpriteArena arena(data.size() / kImageAlignmentInBytes, kImageWidth,
+                    kImageHeight);
+  DecodeCells<Format>(data, [&arena](size_t index) {
+    return [pixels = arena.GetPixels(index)](int x, int y,
+                                             color_t const& color) {
+      pixels[y * kImageWidth + x] = color;
+    };
+  });
+  return arena;
+}
+
+SpriteArena DecodeSpriteArena(std::vector<uint8_t> const& data, bool is_cga) {
+  return is_cga ? DecodeSpriteArena<cga_format_t>(data)
+                : DecodeSpriteArena<ega_format_t>(data);
+}
+
 }  // namespace
 
+std::vector<Image> ParseCgaSpritesheet(std::vector<uint8_t> const& data) {
+  return DecodeImages<cga_format_t>(data);
+}
+
+std::vector<Image> ParseEgaSpritesheet(std::vector<uint8_t> const& data) {
+  return DecodeImages<ega_format_t>(data);
+}
+
 std::vector<Image> LoadCgaSpritesheet(std::string const& filename) {
-  auto const data = ReadBinaryFile(filename);
-  return LoadCgaSpritesheet(data);
+  return ParseCgaSpritesheet(ReadBinaryFile(filename));
 }
 
 std::vector<Image> LoadEgaSpritesheet(std::string const& filename) {
-  auto const data = ReadBinaryFile(filename);
-  return LoadEgaSpritesheet(data);
+  return ParseEgaSpritesheet(ReadBinaryFile(filename));
 }
 
 std::vector<Image> LoadSpritesheet(std::string const& filename) {
   auto const data = ReadBinaryFile(filename);
-  if (memcmp(data.data(), cga_header.data(), cga_header.size()) == 0) {
-    return LoadCgaSpritesheet(data);
+  if (HasHeader(data, cga_header)) {
+    return ParseCgaSpritesheet(data);
+  }
+  if (HasHeader(data, ega_header)) {
+    return ParseEgaSpritesheet(data);
+  }
+  throw std::runtime_error("Unknown spritesheet format: "s + filename);
+}
+
+SpriteArena LoadSpriteArena(std::string const& filename) {
+  auto const data = ReadBinaryFile(filename);
+  if (HasHeader(data, cga_header)) {
+    return DecodeSpriteArena(data, true);
+  }
+  if (HasHeader(data, ega_header)) {
+    return DecodeSpriteArena(data, false);
+  }
+  throw std::runtime_error("Unknown spritesheet format: "s + filename);
+}
+
+SpriteArena LoadSpriteArena(std::string const& filename,
+                            Diagnostics& diagnostics) {
+  std::vector<uint8_t> data;
+  if (!ReadInputFile(filename, data, diagnostics)) {
+    return {};
   }
-  if (memcmp(data.data(), ega_header.data(), ega_header.size()) == 0) {
-    return LoadEgaSpritesheet(data);
+  return ParseSpriteArena(filename, data, diagnostics);
+}
+
+SpriteArena ParseSpriteArena(std::string const& filename,
+                             std::vector<uint8_t> const& data,
+                             Diagnostics& diagnostics) {
+  auto const is_cga = HasHeader(data, cga_header);
+  if (!is_cga && !HasHeader(data, ega_header)) {
+    diagnostics.push_back(
+        {filename, -1, 0, "header", "not a CGA or EGA spritesheet", true});
+    return {};
+  }
+
+  auto const num_images = data.size() / kImageAlignmentInBytes;
+  if (num_images == 0) {
+    diagnostics.push_back({filename, -1, 0, "cell", "no whole cells", true});
+  }
+  if (auto const extra = data.size() % kImageAlignmentInBytes; extra != 0) {
+    diagnostics.push_back({filename, static_cast<int>(num_images),
+                           num_images * kImageAlignmentInBytes, "cell",
+                           std::to_string(extra) +
+                               " trailing bytes don't make a whole cell",
+                           true});
+  }
+  return DecodeSpriteArena(data, is_cga);
+}
+
+LazySpritesheet::LazySpritesheet(std::string const& filename)
+    : data_(ReadBinaryFile(filename)) {
+  if (HasHeader(data_, cga_header)) {
+    format_ = format::cga;
+  } else if (HasHeader(data_, ega_header)) {
+    format_ = format::ega;
+  } else {
+    throw std::runtime_error("Unknown spritesheet format: "s + filename);
+  }
+  cells_.resize(data_.size() / kImageAlignmentInBytes);
+}
+
+Image const& LazySpritesheet::operator[](size_t index) const {
+  auto& cell = cells_.at(index);
+  if (cell) {
+    return *cell;
+  }
+
+  STATS_TIMER("decode sprites");
+  STATS_COUNT(kStatSpritesDecoded, 1);
+  auto& image = cell.emplace(kImageWidth, kImageHeight);
+  auto const* const cell_data = data_.data() + index * kImageAlignmentInBytes;
+  if (format_ == format::cga) {
+    DecodeCgaCell(cell_data, [&image](int x, int y, uint8_t color) {
+      image.Set(x, y, cga_palette[color]);
+    });
+  } else {
+    DecodeEgaCell(cell_data, [&image](int x, int y, uint8_t color) {
+      image.Set(x, y, ega_palette[color]);
+    });
   }
-  return {};
+  return image;
 }
@@ -1,11 +1,59 @@
 #pragma once
 
+#include <cstdint>
+#include <optional>
 #include <string>
+#include <vector>
 
+#include "diagnostic.h"
 #include "image.h"
+#include "sprite_arena.h"
 
+/// Cells are decoded on the shared thread pool. Sheets too small to benefit
+/// are decoded serially.
 std::vector<Image> LoadCgaSpritesheet(std::string const& filename);
 std::vector<Image> LoadEgaSpritesheet(std::string const& filename);
 
-/// Autodetects the file format and loads with the appropriate palette.
+/// Autodetects the file format and loads with the appropriate palette. Throws
+/// std::runtime_error if the format isn't recognized.
 std::vector<Image> LoadSpritesheet(std::string const& filename);
+
+/// Like `LoadSpritesheet` but decodes into a single `SpriteArena`.
+SpriteArena LoadSpriteArena(std::string const& filename);
+
+/// Validating version of the above for untrusted files: problems are added to
+/// `diagnostics` instead of throwing. An unreadable file or unknown format
+/// results in an empty arena.
+SpriteArena LoadSpriteArena(std::string const& filename,
+                            Diagnostics& diagnostics);
+
+/// Versions of the above for files that are already in memory (e.g. received
+/// over the network). `data` is the whole file, and `filename` is only used to
+/// label diagnostics.
+std::vector<Image> ParseCgaSpritesheet(std::vector<uint8_t> const& data);
+std::vector<Image> ParseEgaSpritesheet(std::vector<uint8_t> const& data);
+SpriteArena ParseSpriteArena(std::string const& filename,
+                             std::vector<uint8_t> const& data,
+                             Diagnostics& diagnostics);
+
+/// A spritesheet that decodes each cell the first time it's accessed and keeps
+/// the result. Useful when only a handful of cells are ever drawn (e.g.
+/// rendering a single room). Not thread safe.
+class LazySpritesheet {
+ public:
+  /// Autodetects the file format like `LoadSpritesheet`, and throws the same
+  /// way if it isn't recognized.
+  explicit LazySpritesheet(std::string const& filename);
+
+  Image const& operator[](size_t index) const;
+
+  size_t size() const { return cells_.size(); }
+  bool empty() const { return cells_.empty(); }
+
+ private:
+  enum class format { unknown, cga, ega };
+
+  std::vector<uint8_t> data_;
+  format format_ = format::unknown;
+  mutable std::vector<std::optional<Image>> cells_;
+};
@@ -0,0 +1,229 @@
+#include "stats.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "flags.h"
+#include "image_sink.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::array<char const*, kNumStatCounters> kCounterNames = {
+    "bytes read", "sprites decoded", "rooms parsed", "blits",
+    "pixels written", "bytes written"};
+
+struct stage_total_t {
+  char const* name;
+  uint64_t calls;
+  uint64_t ns;
+};
+
+struct trace_event_t {
+  char const* name;
+  uint64_t start_ns;
+  uint64_t duration_ns;
+  int thread;
+};
+
+struct stats_t {
+  std::array<uint64_t, kNumStatCounters> counters{};
+  // Few enough stages that a linear search beats hashing
+  std::vector<stage_total_t> stages;
+  std::vector<trace_event_t> events;
+
+  void AddStage(char const* name, uint64_t calls, uint64_t ns) {
+    // Names are literals, but the same literal can have different addresses
+    // in different translation units
+    auto const found =
+        std::find_if(stages.begin(), stages.end(), [name](auto const& stage) {
+          return stage.name == name || strcmp(stage.name, name) == 0;
+        });
+    if (found == stages.end()) {
+      stages.push_back({name, calls, ns});
+    } else {
+      found->calls += calls;
+      found->ns += ns;
+    }
+  }
+
+  void Add(stats_t const& other) {
+    for (auto i = 0; i < kNumStatCounters; ++i) {
+      counters[i] += other.counters[i];
+    }
+    for (auto const& stage : other.stages) {
+      AddStage(stage.name, stage.calls, stage.ns);
+    }
+    events.insert(events.end(), other.events.begin(), other.events.end());
+  }
+};
+
+struct thread_stats_t;
+
+/// Totals of every thread that has exited, and the threads still running.
+struct global_stats_t {
+  Clock::time_point const start = Clock::now();
+  std::atomic<bool> tracing{false};
+  std::mutex mutex;
+  stats_t stats;
+  std::vector<thread_stats_t*> live_threads;
+  int num_threads = 0;
+};
+
+global_stats_t& GetGlobalStats() {
+  // Never destroyed, since threads of a static thread pool can exit after
+  // static destructors have run
+  static auto* const global = new global_stats_t;
+  return *global;
+}
+
+/// Each thread's own totals, merged into the global ones when it exits. The
+/// thread pool's workers outlive main, so the report reads live threads'
+/// totals too; the lock is only ever contended while a report is made.
+struct thread_stats_t {
+  thread_stats_t() {
+    auto& global = GetGlobalStats();
+    std::lock_guard<std::mutex> lock(global.mutex);
+    thread = global.num_threads++;
+    global.live_threads.push_back(this);
+  }
+
+  ~thread_stats_t() {
+    auto& global = GetGlobalStats();
+    std::lock_guard<std::mutex> lock(global.mutex);
+    global.stats.Add(stats);
+    global.live_threads.erase(std::find(global.live_threads.begin(),
+                                        global.live_threads.end(), this));
+  }
+
+  std::mutex mutex;
+  stats_t stats;
+  int thread;
+};
+
+thread_stats_t& GetThreadStats() {
+  thread_local thread_stats_t thread_stats;
+  return thread_stats;
+}
+
+uint64_t GetNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             Clock::now() - GetGlobalStats().start)
+      .count();
+}
+
+/// Totals of every thread so far.
+stats_t GetStats() {
+  // Registers the calling thread before the global lock is taken
+  GetThreadStats();
+  auto& global = GetGlobalStats();
+  std::lock_guard<std::mutex> lock(global.mutex);
+  auto stats = global.stats;
+  for (auto* const thread_stats : global.live_threads) {
+    std::lock_guard<std::mutex> thread_lock(thread_stats->mutex);
+    stats.Add(thread_stats->stats);
+  }
+  return stats;
+}
+
+}  // namespace
+
+void AddToStat(StatCounter counter, uint64_t amount) {
+  auto& thread_stats = GetThreadStats();
+  std::lock_guard<std::mutex> lock(thread_stats.mutex);
+  thread_stats.stats.counters[counter] += amount;
+}
+
+StatsTimer::StatsTimer(char const* name) : name_(name) {
+  start_ns_ = GetNowNs();
+}
+
+StatsTimer::~StatsTimer() {
+  auto const duration_ns = GetNowNs() - start_ns_;
+  auto& thread_stats = GetThreadStats();
+  std::lock_guard<std::mutex> lock(thread_stats.mutex);
+  thread_stats.stats.AddStage(name_, 1, duration_ns);
+  if (GetGlobalStats().tracing.load(std::memory_order_relaxed)) {
+    thread_stats.stats.events.push_back(
+        {name_, start_ns_, duration_ns, thread_stats.thread});
+  }
+}
+
+void EnableStatsTrace() { GetGlobalStats().tracing = true; }
+
+void PrintStats(std::ostream& out) {
+  auto const wall_ns = GetNowNs();
+  auto stats = GetStats();
+  std::sort(stats.stages.begin(), stats.stages.end(),
+            [](auto const& a, auto const& b) { return a.ns > b.ns; });
+
+  out << "stage\tcalls\tms\t% of wall\n" << std::fixed << std::setprecision(2);
+  for (auto const& stage : stats.stages) {
+    out << stage.name << '\t' << stage.calls << '\t' << stage.ns / 1e6 << '\t'
+        << 100.0 * stage.ns / wall_ns << '\n';
+  }
+  out << "wall\t1\t" << wall_ns / 1e6 << "\t100.00\n";
+  for (auto i = 0; i < kNumStatCounters; ++i) {
+    out << kCounterNames[i] << '\t' << stats.counters[i] << '\n';
+  }
+}
+
+void WriteChromeTrace(std::string const& filename) {
+  auto const stats = GetStats();
+  auto const out = OpenOutputStream(filename);
+
+  // Timestamps are in microseconds
+  *out << "{\"traceEvents\":[" << std::fixed << std::setprecision(3);
+  for (auto i = 0; i < stats.events.size(); ++i) {
+    auto const& event = stats.events[i];
+    *out << (i == 0 ? "\n" : ",\n") << "{\"name\":\"" << event.name
+         << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+         << ",\"ts\":" << event.start_ns / 1e3
+         << ",\"dur\":" << event.duration_ns / 1e3 << '}';
+  }
+  *out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  out->flush();
+  if (!out->good()) {
+    throw std::runtime_error("Failed to write trace: "s + filename);
+  }
+}
+
+StatsReport::StatsReport(Flags const& flags)
+    : print_(flags.Has("stats")), trace_filename_(flags.Get("trace")) {
+  // Start the wall clock
+  GetGlobalStats();
+  if ((print_ || !trace_filename_.empty()) && !kStatsEnabled) {
+    std::cerr << "Stats aren't compiled in, rebuild with "
+                 "-DEXPLORER_UTILS_STATS=ON\n";
+  }
+  if (!trace_filename_.empty()) {
+    EnableStatsTrace();
+  }
+}
+
+StatsReport::~StatsReport() {
+  if (!kStatsEnabled) {
+    return;
+  }
+  if (print_) {
+    PrintStats(std::cerr);
+  }
+  if (!trace_filename_.empty()) {
+    try {
+      WriteChromeTrace(trace_filename_);
+    } catch (std::runtime_error const& error) {
+      std::cerr << error.what() << '\n';
+    }
+  }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+class Flags;
+
+/// What `STATS_COUNT` can count.
+enum StatCounter : int {
+  kStatBytesRead,
+  kStatSpritesDecoded,
+  kStatRoomsParsed,
+  kStatBlits,
+  kStatPixelsWritten,
+  kStatBytesWritten,
+  kNumStatCounters,
+};
+
+/// The hooks below only do anything when the library is built with
+/// -DEXPLORER_UTILS_STATS=ON. Otherwise they compile to nothing, so they can go
+/// in the hottest loops.
+#ifdef EXPLORER_UTILS_STATS
+inline constexpr bool kStatsEnabled = true;
+#else
+inline constexpr bool kStatsEnabled = false;
+#endif
+
+/// Times the rest of the enclosing scope as one run of the stage `name`, which
+/// must be a string literal. Nested stages are each timed in full.
+#define STATS_TIMER(name) \
+  STATS_TIMER_IMPL(name, STATS_CONCAT(stats_timer_, __LINE__))
+/// Adds `amount` to a `StatCounter`. `amount` isn't evaluated when stats are
+/// compiled out.
+#define STATS_COUNT(counter, amount) STATS_COUNT_IMPL(counter, amount)
+
+#define STATS_CONCAT_INNER(a, b) a##b
+#define STATS_CONCAT(a, b) STATS_CONCAT_INNER(a, b)
+#ifdef EXPLORER_UTILS_STATS
+#define STATS_TIMER_IMPL(name, variable) StatsTimer const variable(name)
+#define STATS_COUNT_IMPL(counter, amount) AddToStat(counter, amount)
+#else
+#define STATS_TIMER_IMPL(name, variable) static_cast<void>(0)
+#define STATS_COUNT_IMPL(counter, amount) static_cast<void>(0)
+#endif
+
+/// Backs `STATS_COUNT`. Counts go to the calling thread's own totals, which are
+/// only merged for a report, so counting doesn't contend.
+void AddToStat(StatCounter counter, uint64_t amount);
+
+/// Backs `STATS_TIMER`.
+class StatsTimer {
+ public:
+  explicit StatsTimer(char const* name);
+  ~StatsTimer();
+
+  StatsTimer(StatsTimer const&) = delete;
+  StatsTimer& operator=(StatsTimer const&) = delete;
+
+ private:
+  char const* name_;
+  uint64_t start_ns_;
+};
+
+/// Keeps every timed run as a trace event too, for `WriteChromeTrace`. Without
+/// this, only per-stage totals are kept.
+void EnableStatsTrace();
+
+/// Prints the calls and total time of every stage and the value of every
+/// counter, over every thread so far.
+void PrintStats(std::ostream& out);
+
+/// Writes the trace events in the Chrome trace event format, which
+/// chrome://tracing and https://ui.perfetto.dev can show as a timeline. Throws
+/// std::runtime_error if the file can't be created.
+void WriteChromeTrace(std::string const& filename);
+
+/// The --stats and --trace out.json flags every tool takes ("stats" has to be
+/// one of the tool's switches). Construct once the flags are parsed; the
+/// report is printed to stderr and the trace written when main returns.
+class StatsReport {
+ public:
+  explicit StatsReport(Flags const& flags);
+  ~StatsReport();
+
+  StatsReport(StatsReport const&) = delete;
+  StatsReport& operator=(StatsReport const&) = delete;
+
+ private:
+  bool print_ = false;
+  std::string trace_filename_;
+};
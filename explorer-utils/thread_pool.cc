@@ -0,0 +1,179 @@
+#include "thread_pool.h"
+
+#include <chrono>
+#include <utility>
+
+namespace {
+
+// Set by each worker so that tasks it submits go on its own queue
+thread_local ThreadPool const* current_pool = nullptr;
+thread_local int current_worker = -1;
+
+std::atomic<int> shared_pool_size{0};
+
+}  // namespace
+
+ThreadPool::ThreadPool(int num_threads) {
+  if (num_threads <= 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (auto i = 1; i < num_threads; ++i) {
+    queues_.push_back(std::make_unique<task_queue_t>());
+  }
+  for (auto i = 0; i < queues_.size(); ++i) {
+    workers_.emplace_back([this, i] { RunWorker(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+  if (workers_.empty()) {
+    task();
+    return;
+  }
+
+  auto index = GetWorkerIndex();
+  if (index < 0) {
+    index = next_queue_++ % queues_.size();
+  }
+  {
+    std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+    queues_[index]->tasks.push_back(std::move(task));
+  }
+  {
+    // Counted under the lock so that a worker can't miss the wake up between
+    // checking for tasks and going to sleep
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    ++num_queued_;
+  }
+  wake_.notify_one();
+}
+
+bool ThreadPool::RunPendingTask() {
+  std::function<void()> task;
+  if (!PopTask(GetWorkerIndex(), task)) {
+    return false;
+  }
+  task();
+  return true;
+}
+
+void ThreadPool::RunWorker(int index) {
+  current_pool = this;
+  current_worker = index;
+  while (true) {
+    std::function<void()> task;
+    if (PopTask(index, task)) {
+      task();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    wake_.wait(lock, [this] { return stopping_ || num_queued_ > 0; });
+    if (stopping_ && num_queued_ <= 0) {
+      return;
+    }
+  }
+}
+
+bool ThreadPool::PopTask(int index, std::function<void()>& task) {
+  if (queues_.empty()) {
+    return false;
+  }
+
+  if (index >= 0) {
+    auto& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+      --num_queued_;
+      return true;
+    }
+  }
+
+  // Steal from the other end, where the biggest chunks of work usually are
+  auto const start = index >= 0 ? index + 1 : next_queue_.load();
+  for (size_t i = 0; i < queues_.size(); ++i) {
+    auto& queue = *queues_[(start + i) % queues_.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      --num_queued_;
+      return true;
+    }
+  }
+  return false;
+}
+
+int ThreadPool::GetWorkerIndex() const {
+  return current_pool == this ? current_worker : -1;
+}
+
+void SetThreadPoolSize(int num_threads) { shared_pool_size = num_threads; }
+
+ThreadPool& GetThreadPool() {
+  static ThreadPool pool(shared_pool_size);
+  return pool;
+}
+
+void TaskGroup::Run(std::function<void()> task) {
+  if (pool_.GetNumThreads() == 1) {
+    RunTask(task);
+    return;
+  }
+
+  ++num_pending_;
+  pool_.Submit([this, task = std::move(task)] {
+    RunTask(task);
+    // Whoever is waiting may destroy the group as soon as the count hits 0,
+    // so it's only touched under the lock that `WaitForTasks` takes last
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--num_pending_ == 0) {
+      done_.notify_all();
+    }
+  });
+}
+
+void TaskGroup::Wait() {
+  WaitForTasks();
+  if (error_) {
+    std::rethrow_exception(std::exchange(error_, nullptr));
+  }
+}
+
+void TaskGroup::RunTask(std::function<void()> const& task) {
+  try {
+    task();
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!error_) {
+      error_ = std::current_exception();
+    }
+  }
+}
+
+void TaskGroup::WaitForTasks() {
+  while (num_pending_ > 0) {
+    if (pool_.RunPendingTask()) {
+      continue;
+    }
+    // Every task left is running somewhere else. Check back now and then in
+    // case one of them queues more work
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait_for(lock, std::chrono::milliseconds(1),
+                   [this] { return num_pending_ == 0; });
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Worker threads for running many small tasks. Each worker has its own deque
+/// of tasks: it runs its newest task first and, when it runs out, steals the
+/// oldest task of another worker. Threads waiting on a `TaskGroup` run queued
+/// tasks too, so parallel work can nest without running out of threads.
+class ThreadPool {
+ public:
+  /// `num_threads` counts the thread that waits for the results, which always
+  /// helps, so a pool of 1 has no workers and every task runs on the thread
+  /// that adds it. 0 means one per core.
+  explicit ThreadPool(int num_threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(ThreadPool const&) = delete;
+  ThreadPool& operator=(ThreadPool const&) = delete;
+
+  int GetNumThreads() const { return static_cast<int>(workers_.size()) + 1; }
+
+  /// Queues `task`. Tasks added by a worker go on its own deque, others are
+  /// spread across the workers.
+  void Submit(std::function<void()> task);
+
+  /// Runs one queued task on the calling thread, if there is one. Returns
+  /// whether it did.
+  bool RunPendingTask();
+
+ private:
+  struct task_queue_t {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void RunWorker(int index);
+  /// The newest task of queue `index` or, failing that (or for -1), the oldest
+  /// task of any other queue.
+  bool PopTask(int index, std::function<void()>& task);
+  /// Queue of the calling thread, or -1 if it isn't one of this pool's.
+  int GetWorkerIndex() const;
+
+  std::vector<std::unique_ptr<task_queue_t>> queues_;
+  std::vector<std::thread> workers_;
+  // Queued tasks, for sleeping workers to wait on. It can dip below 0 when a
+  // task is taken before its submitter has counted it
+  std::atomic<long> num_queued_{0};
+  std::atomic<unsigned> next_queue_{0};
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+};
+
+/// Sets the size of the pool returned by `GetThreadPool` (0 means one thread
+/// per core), e.g. from a tool's --jobs flag. Only has an effect before the
+/// pool is first used.
+void SetThreadPoolSize(int num_threads);
+
+/// The pool shared by the whole library.
+ThreadPool& GetThreadPool();
+
+/// Tasks that can be waited on together. Tasks may add more tasks to the group
+/// while it runs, or wait on groups of their own.
+class TaskGroup {
+ public:
+  explicit TaskGroup(ThreadPool& pool = GetThreadPool()) : pool_(pool) {}
+  /// Waits for the tasks, since they usually refer to the caller's locals.
+  ~TaskGroup() { WaitForTasks(); }
+
+  TaskGroup(TaskGroup const&) = delete;
+  TaskGroup& operator=(TaskGroup const&) = delete;
+
+  void Run(std::function<void()> task);
+
+  /// Returns once every task has finished, running queued tasks (of any group)
+  /// in the meantime. Rethrows the first exception thrown by a task.
+  void Wait();
+
+ private:
+  void RunTask(std::function<void()> const& task);
+  void WaitForTasks();
+
+  ThreadPool& pool_;
+  std::atomic<int> num_pending_{0};
+  std::mutex mutex_;
+  std::condition_variable done_;
+  std::exception_ptr error_;
+};
+
+/// Calls `fn(i)` for every i in [begin, end) on the shared pool. Indices are
+/// split into contiguous ranges of at least `grain`, a few per thread so that
+/// stealing can even out uneven work, and ranges too small to be worth a task
+/// run serially. Returns once every call has, rethrowing the first exception.
+template <typename Fn>
+void ParallelFor(size_t begin, size_t end, size_t grain, Fn&& fn) {
+  constexpr size_t kRangesPerThread = 4;
+
+  auto& pool = GetThreadPool();
+  auto const count = end > begin ? end - begin : 0;
+  auto const num_ranges =
+      std::min(count / std::max<size_t>(grain, 1),
+               static_cast<size_t>(pool.GetNumThreads()) * kRangesPerThread);
+  if (num_ranges <= 1 || pool.GetNumThreads() == 1) {
+    for (auto i = begin; i < end; ++i) {
+      fn(i);
+    }
+    return;
+  }
+
+  TaskGroup group(pool);
+  for (size_t range = 0; range < num_ranges; ++range) {
+    auto const first = begin + count * range / num_ranges;
+    auto const last = begin + count * (range + 1) / num_ranges;
+    group.Run([first, last, &fn] {
+      for (auto i = first; i < last; ++i) {
+        fn(i);
+      }
+    });
+  }
+  group.Wait();
+}
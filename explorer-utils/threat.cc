@@ -0,0 +1,111 @@
+#include "threat.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "object.h"
+#include "tile.h"
+
+namespace {
+
+constexpr auto kKernelSize = 2 * kThreatRadius + 1;
+constexpr auto kExpWeight = 0.1f;
+
+using Kernel = std::array<std::array<float, kKernelSize>, kKernelSize>;
+
+/// Falls off linearly with the distance in moves, diagonals counting as one.
+constexpr Kernel kKernel = [] {
+  Kernel kernel{};
+  for (auto y = 0; y < kKernelSize; ++y) {
+    for (auto x = 0; x < kKernelSize; ++x) {
+      auto const dx = x < kThreatRadius ? kThreatRadius - x : x - kThreatRadius;
+      auto const dy = y < kThreatRadius ? kThreatRadius - y : y - kThreatRadius;
+      auto const distance = std::max(dx, dy);
+      kernel[y][x] = static_cast<float>(kThreatRadius + 1 - distance) /
+                     (kThreatRadius + 1);
+    }
+  }
+  return kernel;
+}();
+
+/// How much of its threat a placed monster adds to a room as a whole.
+constexpr float kKernelTotal = [] {
+  auto total = 0.0f;
+  for (auto const& row : kKernel) {
+    for (auto const weight : row) {
+      total += weight;
+    }
+  }
+  return total;
+}();
+
+// Room with a border wide enough for the whole kernel, so adding it never
+// needs bounds checks and each row is one straight loop the compiler can
+// vectorize
+constexpr auto kPaddedWidth = kRoomWidth + 2 * kThreatRadius;
+constexpr auto kPaddedHeight = kRoomHeight + 2 * kThreatRadius;
+using PaddedMap = std::array<float, kPaddedWidth * kPaddedHeight>;
+
+/// Monsters spawned without a position could be anywhere, so their threat
+/// goes evenly to every walkable cell, totalling what placing them would add.
+void SpreadSpawnedThreat(room_t const& room, float threat, ThreatMap& map) {
+  auto const walkable =
+      std::count_if(room.tiles.begin(), room.tiles.end(),
+                    [](uint8_t tile) { return GetTileInfo(tile).walkable; });
+  if (walkable == 0) {
+    return;
+  }
+  auto const per_cell = room.monster_count * threat * kKernelTotal / walkable;
+  for (auto cell = 0; cell < kRoomArea; ++cell) {
+    if (GetTileInfo(room.tiles[cell]).walkable) {
+      map[cell] += per_cell;
+    }
+  }
+}
+
+}  // namespace
+
+std::vector<float> GetMonsterThreats(MonsterTable const& monsters) {
+  std::vector<float> threats(monsters.size() + 1);
+  for (auto i = 0; i < monsters.size(); ++i) {
+    threats[i + 1] = monsters.levels[i] + monsters.exps[i] * kExpWeight;
+  }
+  return threats;
+}
+
+ThreatMap GetThreatMap(room_t const& room,
+                       std::vector<float> const& monster_threats) {
+  ThreatMap map{};
+  if (room.monster_id >= monster_threats.size()) {
+    return map;
+  }
+  auto const threat = monster_threats[room.monster_id];
+
+  PaddedMap padded{};
+  auto num_placed = 0;
+  for (auto y = 0; y < kRoomHeight; ++y) {
+    for (auto x = 0; x < kRoomWidth; ++x) {
+      if (!GetObjectInfo(room.objects[y * kRoomWidth + x]).is_monster) {
+        continue;
+      }
+      ++num_placed;
+      // The kernel's top-left lands on (x, y) once padding is accounted for
+      for (auto ky = 0; ky < kKernelSize; ++ky) {
+        auto* const row = &padded[(y + ky) * kPaddedWidth + x];
+        for (auto kx = 0; kx < kKernelSize; ++kx) {
+          row[kx] += kKernel[ky][kx] * threat;
+        }
+      }
+    }
+  }
+
+  for (auto y = 0; y < kRoomHeight; ++y) {
+    auto const* const row =
+        &padded[(y + kThreatRadius) * kPaddedWidth + kThreatRadius];
+    std::copy(row, row + kRoomWidth, &map[y * kRoomWidth]);
+  }
+  if (num_placed == 0 && room.monster_count > 0) {
+    SpreadSpawnedThreat(room, threat, map);
+  }
+  return map;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "monster.h"
+#include "room.h"
+
+/// How dangerous each cell of a room is. Every placed monster adds its threat
+/// to its own cell and, fading out, to the cells up to `kThreatRadius` away.
+/// A room with room_t::monster_count set but no monsters placed spawns them
+/// somewhere, so their threat is spread over every walkable cell instead. The
+/// count is ignored once monsters are placed: the placements are what the
+/// player meets, and sample adventures use the same count whatever the
+/// number placed.
+using ThreatMap = std::array<float, kRoomArea>;
+
+constexpr auto kThreatRadius = 3;
+
+/// Threat of every monster, indexed by room_t::monster_id (so entry 0 is
+/// unused). Level counts the most; experience given is a second hint at
+/// strength.
+std::vector<float> GetMonsterThreats(MonsterTable const& monsters);
+
+ThreatMap GetThreatMap(room_t const& room,
+                       std::vector<float> const& monster_threats);
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "trap.h"
+
+/// What a raw room_t::tiles value is.
+struct tile_info_t {
+  /// As shown by the game, see docs/tile-descriptions.html. Null for tiles
+  /// without a description
+  char const* name = nullptr;
+  /// Whether the player can walk onto it. Inferred from the descriptions, so
+  /// it may be wrong for rarely used tiles
+  bool walkable = false;
+};
+
+/// Every possible room_t::tiles value, including traps stored as ASCII.
+inline constexpr std::array<tile_info_t, 256> kTileTable = [] {
+  std::array<tile_info_t, 256> table{};
+  table[1] = {"the floor", true};
+  table[2] = {"sand", true};
+  table[3] = {"a wall", false};
+  table[4] = {"some vegetation", true};
+  table[5] = {"some water", false};
+  table[13] = {"an empty void", false};
+  table[14] = {"a force field", false};
+  table[15] = {"a wooden ship", true};
+  table[16] = {"a flying ship", true};
+  table[17] = {"a metal ship", true};
+  table[19] = {"some rubble", false};
+  table[20] = {"a statue", false};
+  table[21] = {"a trap", true};
+  table[25] = {"a weapon shop", true};
+  table[26] = {"an armor shop", true};
+  table[27] = {"a key shop", true};
+  table[28] = {"a healing shop", true};
+  table[29] = {"a wand shop", true};
+  table[31] = {"some mountains", false};
+  table[32] = {"stairs up", true};
+  table[33] = {"stairs down", true};
+  table[34] = {"a fountain", false};
+  table[35] = {"a glass wall", false};
+  table[36] = {"an altar", false};
+  table[39] = {"a potion shop", true};
+  table[40] = {"a bridge", true};
+  // Needs a metal ship
+  table[41] = {"a lava pool", false};
+  table[42] = {"the floor", true};
+  table[43] = {"a broken wall", false};
+  table[44] = {"a stone column", false};
+  table[45] = {"a deep well", false};
+  table[46] = {"a secret door", true};
+  table[49] = {"some grass", true};
+  table[51] = {"a rock wall", false};
+  table[52] = {"a small city", true};
+  table[53] = {"a tree", false};
+  table[54] = {"some swamp land", true};
+  table[56] = {"an odd design", true};
+  table[57] = {"a building", true};
+  table[58] = {"a wall niche", false};
+  table[59] = {"a wall niche", false};
+  table[60] = {"a standing ston", false};
+  table[61] = {"a stick", false};
+  table[62] = {"a stone", false};
+  table[77] = {"a pool", false};
+  table[78] = {"a tile floor", true};
+  table[79] = {"a wooden floor", true};
+  table[81] = {"a repel field", false};
+  for (auto tile = kMaxTile + 1; tile < 256; ++tile) {
+    table[tile] = {"a trap", true};
+  }
+  return table;
+}();
+
+constexpr tile_info_t const& GetTileInfo(uint8_t tile) {
+  return kTileTable[tile];
+}
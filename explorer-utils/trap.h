@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "color.h"
+
+/// Raw room_t::tiles value of the regular trap tile ("a trap").
+constexpr uint8_t kTrapTile = 21;
+/// Highest room_t::tiles value that is a real tile. Anything above it is a
+/// trap stored as an ASCII character (wands, XP, ...).
+constexpr uint8_t kMaxTile = 84;
+
+enum class trap_kind : uint8_t {
+  none,
+  /// The trap tile itself
+  plain,
+  /// A tile above kMaxTile. What each character does isn't known yet, so
+  /// they're told apart by `trap_info_t::code`
+  coded,
+};
+
+struct trap_info_t {
+  trap_kind kind = trap_kind::none;
+  /// The tile value for coded traps (kMaxTile + 1 to 255), 0 otherwise.
+  /// Editors show it as a character, which is only printable ASCII up to 126
+  uint8_t code = 0;
+  /// The room_t::tiles value to draw: the trap tile for every trap
+  uint8_t tile = 0;
+  /// Unique for each distinct trap, 0 for tiles that aren't traps
+  uint8_t id = 0;
+};
+
+/// Classification of every possible room_t::tiles value.
+inline constexpr std::array<trap_info_t, 256> kTrapTable = [] {
+  std::array<trap_info_t, 256> table{};
+  for (auto tile = 0; tile < 256; ++tile) {
+    auto& info = table[tile];
+    info.tile = static_cast<uint8_t>(tile);
+    if (tile == kTrapTile) {
+      info.kind = trap_kind::plain;
+      info.id = 1;
+    } else if (tile > kMaxTile) {
+      info.kind = trap_kind::coded;
+      info.code = static_cast<uint8_t>(tile);
+      info.tile = kTrapTile;
+      info.id = static_cast<uint8_t>(tile - kMaxTile + 1);
+    }
+  }
+  return table;
+}();
+
+/// Number of distinct `trap_info_t::id`s, including 0 for "not a trap".
+constexpr auto kNumTrapIds = 256 - kMaxTile + 1;
+
+constexpr trap_info_t const& GetTrapInfo(uint8_t tile) {
+  return kTrapTable[tile];
+}
+
+constexpr bool IsTrap(uint8_t tile) {
+  return kTrapTable[tile].kind != trap_kind::none;
+}
+
+/// Overlay color for a trap. Plain traps are red. Coded traps cycle through
+/// the other bright EGA colors so that neighbouring codes look different.
+constexpr color_t GetTrapColor(trap_info_t const& info) {
+  constexpr std::array<color_t, 6> kCodedColors = {
+      color_t{0x55, 0xFF, 0x55}, color_t{0x55, 0xFF, 0xFF},
+      color_t{0xFF, 0x55, 0xFF}, color_t{0xFF, 0xFF, 0x55},
+      color_t{0x55, 0x55, 0xFF}, color_t{0xFF, 0xFF, 0xFF},
+  };
+  if (info.kind == trap_kind::coded) {
+    return kCodedColors[info.code % kCodedColors.size()];
+  }
+  return color_t{0xFF, 0x55, 0x55};
+}
@@ -0,0 +1,163 @@
+#include <explorer-utils/diagnostic.h>
+#include <explorer-utils/flags.h>
+#include <explorer-utils/monster.h>
+#include <explorer-utils/room.h>
+#include <explorer-utils/spritesheet.h>
+#include <explorer-utils/stats.h>
+#include <explorer-utils/thread_pool.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr auto cga_header = std::array<uint8_t, 4>{0x0E, 0x00, 0x0E, 0x00};
+constexpr auto ega_header = std::array<uint8_t, 4>{0x1D, 0x00, 0x0E, 0x00};
+
+/// Decodes `data` and returns something derived from the result, so that the
+/// work can't be optimized away.
+using Decoder = std::function<size_t(std::vector<uint8_t> const& data)>;
+
+struct stress_target_t {
+  char const* name;
+  Decoder decode;
+  // Random bytes almost never start with a valid header, so half of the
+  // inputs get one of these to reach past the format check
+  std::vector<std::array<uint8_t, 4>> headers;
+};
+
+struct stress_result_t {
+  size_t inputs = 0;
+  size_t bytes = 0;
+  double seconds = 0;
+  double worst_seconds = 0;
+  std::vector<uint8_t> worst_input;
+  size_t checksum = 0;
+};
+
+std::vector<stress_target_t> GetTargets() {
+  return {
+      {"cga", [](auto const& data) { return ParseCgaSpritesheet(data).size(); },
+       {cga_header}},
+      {"ega", [](auto const& data) { return ParseEgaSpritesheet(data).size(); },
+       {ega_header}},
+      {"arena",
+       [](auto const& data) {
+         Diagnostics diagnostics;
+         return ParseSpriteArena("stress", data, diagnostics).size() +
+                diagnostics.size();
+       },
+       {cga_header, ega_header}},
+      {"monsters",
+       [](auto const& data) {
+         Diagnostics diagnostics;
+         return ParseMonsterData("stress", data, diagnostics).size() +
+                ParseMonsterTable(data).size() + diagnostics.size();
+       },
+       {}},
+      {"rooms",
+       [](auto const& data) {
+         Diagnostics diagnostics;
+         return ParseRooms("stress", data, diagnostics).size() +
+                diagnostics.size();
+       },
+       {}},
+  };
+}
+
+/// Random bytes of a random length up to `max_size`.
+std::vector<uint8_t> MakeInput(std::mt19937_64& random, size_t max_size,
+                               stress_target_t const& target) {
+  std::vector<uint8_t> data(random() % (max_size + 1));
+  for (auto& byte : data) {
+    byte = static_cast<uint8_t>(random());
+  }
+  if (!target.headers.empty() && random() % 2 == 0) {
+    auto const& header = target.headers[random() % target.headers.size()];
+    std::copy_n(header.begin(), std::min(header.size(), data.size()),
+                data.begin());
+  }
+  return data;
+}
+
+/// Decodes random inputs for `seconds`, timing only the decoder.
+stress_result_t Stress(stress_target_t const& target, double seconds,
+                       size_t max_size, std::mt19937_64& random) {
+  using Clock = std::chrono::steady_clock;
+
+  stress_result_t result;
+  while (result.seconds < seconds) {
+    auto input = MakeInput(random, max_size, target);
+
+    auto const start = Clock::now();
+    result.checksum += target.decode(input);
+    auto const elapsed =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    ++result.inputs;
+    result.bytes += input.size();
+    result.seconds += elapsed;
+    if (elapsed > result.worst_seconds) {
+      result.worst_seconds = elapsed;
+      result.worst_input = std::move(input);
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Flags const flags(argc, argv, {"stats"});
+  auto const& args = flags.GetPositional();
+  if (!args.empty()) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--seconds S] [--max-size BYTES] [--seed N] "
+                 "[--only cga|ega|arena|monsters|rooms] [--save-worst dir]\n"
+              << "Decodes random inputs for S seconds per decoder and prints "
+                 "throughput and the slowest input.\n";
+    return 1;
+  }
+
+  StatsReport const stats_report(flags);
+  SetThreadPoolSize(flags.GetInt("jobs", 0));
+
+  auto const seconds = std::stod(flags.Get("seconds", "1"));
+  auto const max_size =
+      static_cast<size_t>(std::max(0, flags.GetInt("max-size", 65536)));
+  auto const only = flags.Get("only", "");
+  auto const save_worst = flags.Get("save-worst", "");
+  std::mt19937_64 random(flags.GetInt("seed", 1));
+
+  std::cout << "decoder\tinputs\tMB/s\tavg us\tworst us\tworst bytes\n";
+  for (auto const& target : GetTargets()) {
+    if (!only.empty() && only != target.name) {
+      continue;
+    }
+    auto const result = Stress(target, seconds, max_size, random);
+
+    std::cout << target.name << '\t' << result.inputs << '\t' << std::fixed
+              << std::setprecision(1) << result.bytes / result.seconds / 1e6
+              << '\t' << result.seconds / result.inputs * 1e6 << '\t'
+              << result.worst_seconds * 1e6 << '\t'
+              << result.worst_input.size() << '\n';
+
+    // Keep the slowest input to replay through the matching fuzz target
+    if (!save_worst.empty()) {
+      std::ofstream out(save_worst + "/" + target.name + ".bin",
+                        std::ios_base::binary);
+      out.write(reinterpret_cast<char const*>(result.worst_input.data()),
+                result.worst_input.size());
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,20 @@
+#include <explorer-utils/spritesheet.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(uint8_t const* data, size_t size) {
+  std::vector<uint8_t> const bytes(data, data + size);
+
+  // The raw decoder takes the format on trust, whatever the header says
+  auto const images = ParseEgaSpritesheet(bytes);
+
+  Diagnostics diagnostics;
+  auto const arena = ParseSpriteArena("fuzz", bytes, diagnostics);
+  if (!arena.empty() && arena.size() != images.size()) {
+    std::abort();
+  }
+  return 0;
+}
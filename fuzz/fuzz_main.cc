@@ -0,0 +1,48 @@
+#include <explorer-utils/file.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(uint8_t const* data, size_t size);
+
+namespace {
+
+void RunFile(std::filesystem::path const& path) {
+  auto const data = ReadBinaryFile(path.string());
+  LLVMFuzzerTestOneInput(data.data(), data.size());
+}
+
+}  // namespace
+
+/// libFuzzer comes with Clang. Elsewhere this stands in for its main() and
+/// runs the target once on every file named on the command line (directories
+/// are walked), which is enough to replay the corpus or a crashing input under
+/// the sanitizers.
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " input|directory...\n";
+    return 1;
+  }
+
+  auto num_inputs = 0;
+  for (auto i = 1; i < argc; ++i) {
+    std::filesystem::path const path(argv[i]);
+    if (!std::filesystem::is_directory(path)) {
+      RunFile(path);
+      ++num_inputs;
+      continue;
+    }
+    for (auto const& entry :
+         std::filesystem::recursive_directory_iterator(path)) {
+      if (entry.is_regular_file()) {
+        RunFile(entry.path());
+        ++num_inputs;
+      }
+    }
+  }
+  std::cerr << "Ran " << num_inputs << " inputs\n";
+  return 0;
+}
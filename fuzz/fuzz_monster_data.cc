@@ -0,0 +1,32 @@
+#include <explorer-utils/monster.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(uint8_t const* data, size_t size) {
+  std::vector<uint8_t> const bytes(data, data + size);
+
+  auto const monsters = ParseMonsterData(bytes);
+  auto const table = ParseMonsterTable(bytes);
+  if (table.size() != monsters.size()) {
+    std::abort();
+  }
+  for (auto i = 0; i < table.size(); ++i) {
+    // Names can repeat, in which case the first one wins
+    auto const found = table.Find(table.names[i]);
+    if (found < 0 || found > i || table.ids[i] != monsters[i].gfx) {
+      std::abort();
+    }
+  }
+
+  // Vary how many sprites there are to check graphics against
+  Diagnostics diagnostics;
+  auto const validated =
+      ParseMonsterData("fuzz", bytes, diagnostics, size == 0 ? 0 : data[0]);
+  if (validated.size() != monsters.size()) {
+    std::abort();
+  }
+  return 0;
+}
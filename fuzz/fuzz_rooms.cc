@@ -0,0 +1,148 @@
+#include <explorer-utils/image.h>
+#include <explorer-utils/monster.h>
+#include <explorer-utils/room.h>
+#include <explorer-utils/room_reach.h>
+#include <explorer-utils/room_render.h>
+#include <explorer-utils/sprite_arena.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Rendering is much slower than parsing, so only the first few rooms of an
+// input are drawn
+constexpr auto kMaxRenderedRooms = 4;
+
+constexpr uint8_t kStairsUpTile = 32;
+constexpr uint8_t kStairsDownTile = 33;
+constexpr uint8_t kOddDesignTile = 56;
+
+/// Whether the player can take `exit` from (x, y). Coming in through an exit
+/// puts them on the same cells, except for the teleport, which is one way.
+bool IsOnExit(room_t const& room, int x, int y, int exit) {
+  switch (exit) {
+    case kExitNorth:
+      return y == 0;
+    case kExitEast:
+      return x == kRoomWidth - 1;
+    case kExitSouth:
+      return y == kRoomHeight - 1;
+    case kExitWest:
+      return x == 0;
+    case kExitUp:
+      return room.GetTile(x, y) == kStairsUpTile;
+    case kExitDown:
+      return room.GetTile(x, y) == kStairsDownTile;
+    default:
+      return room.GetTile(x, y) == kOddDesignTile;
+  }
+}
+
+/// GetRoomReach the slow way, a breadth-first search one cell at a time.
+room_reach_t GetRoomReachByBfs(room_t const& room,
+                               reach_options_t const& options) {
+  auto const walkable = GetWalkableCells(room, options);
+  auto const is_walkable = [&walkable](int x, int y) {
+    return (walkable[y] >> x & 1) != 0;
+  };
+
+  room_reach_t reach;
+  for (auto entry = 0; entry < kExitTeleport; ++entry) {
+    std::vector<bool> seen(kRoomArea, false);
+    std::vector<int> queue;
+    for (auto y = 0; y < kRoomHeight; ++y) {
+      for (auto x = 0; x < kRoomWidth; ++x) {
+        if (is_walkable(x, y) && IsOnExit(room, x, y, entry)) {
+          seen[y * kRoomWidth + x] = true;
+          queue.push_back(y * kRoomWidth + x);
+        }
+      }
+    }
+    for (size_t i = 0; i < queue.size(); ++i) {
+      auto const x = queue[i] % kRoomWidth;
+      auto const y = queue[i] / kRoomWidth;
+      for (auto exit = 0; exit < kNumRoomExits; ++exit) {
+        if (IsOnExit(room, x, y, exit) &&
+            HasExit(room, static_cast<RoomExit>(exit))) {
+          reach.exits[entry] |= 1 << exit;
+        }
+      }
+      constexpr int kSteps[4][2] = {{0, -1}, {1, 0}, {0, 1}, {-1, 0}};
+      for (auto const& [dx, dy] : kSteps) {
+        auto const next_x = x + dx;
+        auto const next_y = y + dy;
+        if (next_x < 0 || next_x >= kRoomWidth || next_y < 0 ||
+            next_y >= kRoomHeight || !is_walkable(next_x, next_y) ||
+            seen[next_y * kRoomWidth + next_x]) {
+          continue;
+        }
+        seen[next_y * kRoomWidth + next_x] = true;
+        queue.push_back(next_y * kRoomWidth + next_x);
+      }
+    }
+  }
+  return reach;
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(uint8_t const* data, size_t size) {
+  std::vector<uint8_t> const bytes(data, data + size);
+  auto const rooms = ParseRooms(bytes);
+
+  Diagnostics diagnostics;
+  auto const num_monsters = size == 0 ? 0 : data[0];
+  if (ParseRooms("fuzz", bytes, diagnostics, num_monsters).size() !=
+      rooms.size()) {
+    std::abort();
+  }
+
+  // Streaming has to agree with loading everything at once
+  std::istringstream in(std::string(bytes.begin(), bytes.end()));
+  RoomReader reader(in);
+  room_t room;
+  while (reader.Next(room)) {
+    auto const& expected = rooms.at(reader.GetCount() - 1);
+    if (room.tiles != expected.tiles || room.objects != expected.objects ||
+        room.name != expected.name) {
+      std::abort();
+    }
+  }
+  if (reader.GetCount() != rooms.size()) {
+    std::abort();
+  }
+
+  // Sheets and monster data that are too short for the rooms, as they would
+  // be when mixing files from different adventures
+  SpriteArena const tiles(size == 0 ? 1 : std::max(1, data[size - 1] / 2),
+                          15, 15);
+  SpriteArena const monsters(size < 2 ? 0 : data[size - 2] / 4, 15, 15);
+  std::vector<monster_t> monster_data(num_monsters / 4);
+  for (auto i = 0; i < monster_data.size(); ++i) {
+    monster_data[i].gfx = data[i % size];
+  }
+  RoomRenderer<SpriteArena> renderer(tiles, monsters, monsters, monster_data);
+  renderer.SetQuasits(std::vector<bool>(num_monsters, true));
+
+  Image strip(renderer.GetRoomWidth(), renderer.GetCellHeight());
+  for (auto i = 0; i < rooms.size() && i < kMaxRenderedRooms; ++i) {
+    for (auto y = 0; y < kRoomHeight; ++y) {
+      renderer.RenderRow(rooms[i], y, kRenderAll, strip);
+    }
+    for (auto const pass_blocks : {false, true}) {
+      reach_options_t options;
+      options.pass_blocks = pass_blocks;
+      if (GetRoomReach(rooms[i], options).exits !=
+          GetRoomReachByBfs(rooms[i], options).exits) {
+        std::abort();
+      }
+    }
+  }
+  return 0;
+}
@@ -1,5 +1,8 @@
 #include <explorer-utils/file.h>
+#include <explorer-utils/flags.h>
 #include <explorer-utils/spritesheet.h>
+#include <explorer-utils/stats.h>
+#include <explorer-utils/thread_pool.h>
 #include <stb_image_write/stb_image_write.h>
 
 #include <fstream>
@@ -7,15 +10,20 @@
 #include <string>
 
 int main(int argc, char** argv) {
-  if (argc < 3) {
+  Flags const flags(argc, argv, {"stats"});
+  auto const& args = flags.GetPositional();
+  if (args.size() < 2) {
     std::cerr << "Usage: " << argv[0] << " pymask.pic cgamask.pic\n";
     std::cerr << "Converts pymask.pic from EGA to CGA and stores it in to "
                  "cgamask.pic\n";
     return 1;
   }
 
-  auto const pymask_filename = argv[1];
-  auto const cgamask_filename = argv[2];
+  StatsReport const stats_report(flags);
+  SetThreadPoolSize(flags.GetInt("jobs", 0));
+
+  auto const& pymask_filename = args[0];
+  auto const& cgamask_filename = args[1];
 
   auto const pymask_images = LoadEgaSpritesheet(pymask_filename);
 
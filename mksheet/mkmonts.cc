@@ -1,7 +1,11 @@
+#include <explorer-utils/flags.h>
 #include <explorer-utils/monster.h>
+#include <explorer-utils/png.h>
 #include <explorer-utils/spritesheet.h>
-#include <stb_image_write/stb_image_write.h>
+#include <explorer-utils/stats.h>
+#include <explorer-utils/thread_pool.h>
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 
@@ -10,21 +14,29 @@ constexpr auto kImageComponents = 4;  // RGBA
 }  // namespace
 
 int main(int argc, char** argv) {
-  if (argc)
+  Flags const flags(argc, argv, {"stats"});
+  auto const& args = flags.GetPositional();
+  if (args.size() < 4) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--level 0-9] [--scale N] pymon.pic pymask.pic pymon.dat "
+                 "out.png\n";
+    return 1;
+  }
 
-    if (argc < 5) {
-      std::cerr << "Usage: " << argv[0]
-                << " pymon.pic pymask.pic pymon.dat out.png\n";
-      return 1;
-    }
+  StatsReport const stats_report(flags);
+  SetThreadPoolSize(flags.GetInt("jobs", 0));
+
+  auto const& pymon_pic_filename = args[0];
+  auto const& pymask_pic_filename = args[1];
+  auto const& pymon_dat_filename = args[2];
+  auto const& out_filename = args[3];
 
-  auto const pymon_pic_filename = argv[1];
-  auto const pymask_pic_filename = argv[2];
-  auto const pymon_dat_filename = argv[3];
-  auto const out_filename = argv[4];
+  PngOptions png_options;
+  png_options.level = flags.GetInt("level", png_options.level);
+  auto const scale = std::max(1, flags.GetInt("scale", 1));
 
-  auto const pymon_pic = LoadSpritesheet(pymon_pic_filename);
-  auto const pymask_pic = LoadSpritesheet(pymask_pic_filename);
+  auto const pymon_pic = LoadSpriteArena(pymon_pic_filename);
+  auto const pymask_pic = LoadSpriteArena(pymask_pic_filename);
   auto const pymon_dat = LoadMonsterData(pymon_dat_filename);
 
   auto const spritesheet_width = 10;
@@ -32,41 +44,55 @@ int main(int argc, char** argv) {
                                       ? (int)(pymon_dat.size() / 10)
                                       : (int)(pymon_dat.size() / 10) + 1;
 
-  auto const atlas_width = pymon_pic[0].GetWidth() * spritesheet_width;
+  auto const atlas_width = pymon_pic.GetWidth() * scale * spritesheet_width;
   auto const atlas_stride = atlas_width * kImageComponents;
-  auto const atlas_height = pymon_pic[0].GetHeight() * spritesheet_height;
+  auto const atlas_height = pymon_pic.GetHeight() * scale * spritesheet_height;
   auto atlas = std::vector<uint8_t>(atlas_stride * atlas_height, 0);
 
-  for (auto i = 0; i < pymon_dat.size(); ++i) {
-    auto const gfx = pymon_dat[i].gfx - 1;
-    auto& image = pymon_pic[gfx];
-    auto& mask = pymask_pic[gfx];
+  {
+    STATS_TIMER("fill atlas");
+    for (auto i = 0; i < pymon_dat.size(); ++i) {
+      auto const gfx = pymon_dat[i].gfx - 1;
+      if (gfx < 0 || gfx >= pymon_pic.size() || gfx >= pymask_pic.size()) {
+        std::cerr << "Skipping monster " << i << ": graphic "
+                  << +pymon_dat[i].gfx << " isn't in " << pymon_pic_filename
+                  << '\n';
+        continue;
+      }
+      auto const image = pymon_pic[gfx];
+      auto const mask = pymask_pic[gfx];
 
-    for (auto yy = 0; yy < image.GetHeight(); ++yy) {
-      for (auto xx = 0; xx < image.GetWidth(); ++xx) {
-        if (mask.Get(xx, yy) != color_black) {
-          continue;
-        }
+      for (auto yy = 0; yy < image.GetHeight(); ++yy) {
+        for (auto xx = 0; xx < image.GetWidth(); ++xx) {
+          if (mask.Get(xx, yy) != color_black) {
+            continue;
+          }
 
-        auto const color = image.Get(xx, yy);
+          auto const color = image.Get(xx, yy);
 
-        auto const basex = (i % spritesheet_width) * image.GetWidth();
-        auto const drawx = basex + xx;
-        auto const basey = (i / spritesheet_width) * image.GetWidth();
-        auto const drawy = basey + yy;
+          auto const basex = (i % spritesheet_width) * image.GetWidth();
+          auto const drawx = (basex + xx) * scale;
+          auto const basey = (i / spritesheet_width) * image.GetWidth();
+          auto const drawy = (basey + yy) * scale;
 
-        auto const index = (drawy * atlas_stride) + (drawx * kImageComponents);
-        auto offset = index;
-        atlas[offset++] = color.r;
-        atlas[offset++] = color.g;
-        atlas[offset++] = color.b;
-        atlas[offset++] = 255;
+          // Each pixel becomes a scale x scale block
+          for (auto sy = 0; sy < scale; ++sy) {
+            auto offset =
+                ((drawy + sy) * atlas_stride) + (drawx * kImageComponents);
+            for (auto sx = 0; sx < scale; ++sx) {
+              atlas[offset++] = color.r;
+              atlas[offset++] = color.g;
+              atlas[offset++] = color.b;
+              atlas[offset++] = 255;
+            }
+          }
+        }
       }
     }
   }
 
-  stbi_write_png(out_filename, atlas_width, atlas_height, kImageComponents,
-                 atlas.data(), atlas_stride);
+  WritePng(out_filename, atlas_width, atlas_height, kImageComponents,
+           atlas.data(), atlas_stride, png_options);
 
   return 0;
 }
@@ -1,7 +1,11 @@
-#include <explorer-utils/room.h>
+#include <explorer-utils/flags.h>
+#include <explorer-utils/object.h>
+#include <explorer-utils/png.h>
 #include <explorer-utils/spritesheet.h>
-#include <stb_image_write/stb_image_write.h>
+#include <explorer-utils/stats.h>
+#include <explorer-utils/thread_pool.h>
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 
@@ -10,15 +14,25 @@ constexpr auto kImageComponents = 4;  // RGBA
 }  // namespace
 
 int main(int argc, char** argv) {
-  if (argc < 3) {
-    std::cerr << "Usage: " << argv[0] << " egapics.pic out.png\n";
+  Flags const flags(argc, argv, {"stats"});
+  auto const& args = flags.GetPositional();
+  if (args.size() < 2) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--level 0-9] [--scale N] egapics.pic out.png\n";
     return 1;
   }
 
-  auto const egapics_filename = argv[1];
-  auto const out_filename = argv[2];
+  StatsReport const stats_report(flags);
+  SetThreadPoolSize(flags.GetInt("jobs", 0));
 
-  auto const egapics = LoadSpritesheet(egapics_filename);
+  auto const& egapics_filename = args[0];
+  auto const& out_filename = args[1];
+
+  PngOptions png_options;
+  png_options.level = flags.GetInt("level", png_options.level);
+  auto const scale = std::max(1, flags.GetInt("scale", 1));
+
+  auto const egapics = LoadSpriteArena(egapics_filename);
 
   auto constexpr first_object = 'd';
   auto constexpr last_object = 'w';
@@ -30,47 +44,56 @@ int main(int argc, char** argv) {
           ? (int)(number_of_objects / spritesheet_width)
           : (int)(number_of_objects / spritesheet_width) + 1;
 
-  auto const atlas_width = egapics[0].GetWidth() * spritesheet_width;
+  auto const atlas_width = egapics.GetWidth() * scale * spritesheet_width;
   auto const atlas_stride = atlas_width * kImageComponents;
-  auto const atlas_height = egapics[0].GetHeight() * spritesheet_height;
+  auto const atlas_height = egapics.GetHeight() * scale * spritesheet_height;
   auto atlas = std::vector<uint8_t>(atlas_stride * atlas_height, 0);
 
-  for (auto i = 0; i < number_of_objects; ++i) {
-    auto const object = first_object + i;
-    auto const image_tile = GetObjectTile(object);
-    auto const mask_tile = GetObjectTileMask(object);
-
-    if (image_tile == 0) {
-      continue;
-    }
+  {
+    STATS_TIMER("fill atlas");
+    for (auto i = 0; i < number_of_objects; ++i) {
+      auto const object = first_object + i;
+      auto const& info = GetObjectInfo(object);
+      auto const image_tile = info.tile;
+      auto const mask_tile = info.mask;
 
-    auto const& image = egapics[image_tile];
+      if (image_tile == 0) {
+        continue;
+      }
 
-    for (auto yy = 0; yy < image.GetHeight(); ++yy) {
-      for (auto xx = 0; xx < image.GetWidth(); ++xx) {
-        if (mask_tile && egapics[mask_tile].Get(xx, yy) != color_black) {
-          continue;
+      auto const image = egapics[image_tile];
+
+      for (auto yy = 0; yy < image.GetHeight(); ++yy) {
+        for (auto xx = 0; xx < image.GetWidth(); ++xx) {
+          if (mask_tile && egapics[mask_tile].Get(xx, yy) != color_black) {
+            continue;
+          }
+
+          auto const color = image.Get(xx, yy);
+
+          auto const basex = (i % spritesheet_width) * image.GetWidth();
+          auto const drawx = (basex + xx) * scale;
+          auto const basey = (i / spritesheet_width) * image.GetWidth();
+          auto const drawy = (basey + yy) * scale;
+
+          // Each pixel becomes a scale x scale block
+          for (auto sy = 0; sy < scale; ++sy) {
+            auto offset =
+                ((drawy + sy) * atlas_stride) + (drawx * kImageComponents);
+            for (auto sx = 0; sx < scale; ++sx) {
+              atlas[offset++] = color.r;
+              atlas[offset++] = color.g;
+              atlas[offset++] = color.b;
+              atlas[offset++] = 255;
+            }
+          }
         }
-
-        auto const color = image.Get(xx, yy);
-
-        auto const basex = (i % spritesheet_width) * image.GetWidth();
-        auto const drawx = basex + xx;
-        auto const basey = (i / spritesheet_width) * image.GetWidth();
-        auto const drawy = basey + yy;
-
-        auto const index = (drawy * atlas_stride) + (drawx * kImageComponents);
-        auto offset = index;
-        atlas[offset++] = color.r;
-        atlas[offset++] = color.g;
-        atlas[offset++] = color.b;
-        atlas[offset++] = 255;
       }
     }
   }
 
-  stbi_write_png(out_filename, atlas_width, atlas_height, kImageComponents,
-                 atlas.data(), atlas_stride);
+  WritePng(out_filename, atlas_width, atlas_height, kImageComponents,
+           atlas.data(), atlas_stride, png_options);
 
   return 0;
 }
@@ -1,44 +1,63 @@
+#include <explorer-utils/flags.h>
+#include <explorer-utils/image_sink.h>
+#include <explorer-utils/png.h>
 #include <explorer-utils/spritesheet.h>
-#include <stb_image_write/stb_image_write.h>
+#include <explorer-utils/stats.h>
+#include <explorer-utils/thread_pool.h>
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 
 namespace {
-constexpr auto kImageComponents = 3;  // RGB
+
+// Blitting a cell is quick, so only big sheets are worth splitting up
+constexpr auto kMinCellsPerTask = 64;
+
 }  // namespace
 
 int main(int argc, char** argv) {
-  if (argc)
+  Flags const flags(argc, argv, {"stats"});
+  auto const& args = flags.GetPositional();
+  if (args.size() < 2) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--format png|ppm|qoi|rgb|indexed] [--level 0-9] "
+                 "[--scale N] in.pic out.png\n";
+    return 1;
+  }
 
-    if (argc < 3) {
-      std::cerr << "Usage: " << argv[0] << " in.pic out.png\n";
-      return 1;
-    }
+  StatsReport const stats_report(flags);
+  SetThreadPoolSize(flags.GetInt("jobs", 0));
 
-  auto const in_filename = argv[1];
-  auto const out_filename = argv[2];
+  auto const& in_filename = args[0];
+  auto const& out_filename = args[1];
 
-  auto images = LoadSpritesheet(in_filename);
+  PngOptions png_options;
+  png_options.level = flags.GetInt("level", png_options.level);
+  auto const format = ParseImageFormat(flags.Get("format", "png"));
+  auto const scale = std::max(1, flags.GetInt("scale", 1));
+
+  auto const images = LoadSpriteArena(in_filename);
 
   auto const spritesheet_width = 10;
   auto const spritesheet_height = images.size() % 10 == 0
                                       ? (int)(images.size() / 10)
                                       : (int)(images.size() / 10) + 1;
-  auto atlas = Image{images[0].GetWidth() * spritesheet_width,
-                     images[0].GetHeight() * spritesheet_height};
-
-  for (auto i = 0; i < images.size(); ++i) {
-    auto& image = images[i];
-    atlas.Blit(images[i], (i % spritesheet_width) * image.GetWidth(),
-               (i / spritesheet_width) * image.GetHeight());
+  auto const cell_width = images.GetWidth() * scale;
+  auto const cell_height = images.GetHeight() * scale;
+  auto atlas = Image{cell_width * spritesheet_width,
+                     cell_height * spritesheet_height};
+
+  {
+    STATS_TIMER("fill atlas");
+    // Cells don't overlap, so they can be filled in parallel
+    ParallelFor(0, images.size(), kMinCellsPerTask, [&](size_t i) {
+      atlas.Blit(images[i], (i % spritesheet_width) * cell_width,
+                 (i / spritesheet_width) * cell_height, scale);
+    });
   }
 
-  // XXX: I'm relying on color_t to serialize properly without
-  // intervention which may not be the case on non-x86 platforms
-  stbi_write_png(out_filename, atlas.GetWidth(), atlas.GetHeight(),
-                 kImageComponents, atlas.GetData().data(),
-                 atlas.GetWidth() * kImageComponents);
+  WriteImage(out_filename, format, atlas, png_options);
 
   return 0;
 }
@@ -1,35 +1,72 @@
+#include <explorer-utils/file_writer.h>
+#include <explorer-utils/flags.h>
+#include <explorer-utils/image_sink.h>
+#include <explorer-utils/png.h>
 #include <explorer-utils/spritesheet.h>
-#include <stb_image_write/stb_image_write.h>
+#include <explorer-utils/stats.h>
+#include <explorer-utils/thread_pool.h>
 
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 
-namespace {
-constexpr auto kImageComponents = 3;  // RGB
-}  // namespace
-
 int main(int argc, char** argv) {
-  if (argc)
+  Flags const flags(argc, argv, {"stats"});
+  auto const& args = flags.GetPositional();
+  if (args.size() < 2) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--format png|ppm|qoi|rgb|indexed] [--level 0-9] "
+                 "[--scale N] [--queue-mb N] in.pic out_prefix\n";
+    return 1;
+  }
 
-    if (argc < 3) {
-      std::cerr << "Usage: " << argv[0] << " in.pic out_prefix\n";
-      return 1;
-    }
+  StatsReport const stats_report(flags);
+  SetThreadPoolSize(flags.GetInt("jobs", 0));
 
-  auto const in_filename = argv[1];
-  auto const out_prefix = argv[2];
+  auto const& in_filename = args[0];
+  auto const& out_prefix = args[1];
 
-  auto images = LoadSpritesheet(in_filename);
+  PngOptions png_options;
+  png_options.level = flags.GetInt("level", png_options.level);
+  auto const format = ParseImageFormat(flags.Get("format", "png"));
+  auto const scale = std::max(1, flags.GetInt("scale", 1));
 
-  for (auto i = 0; i < images.size(); ++i) {
-    auto const out_filename = out_prefix + std::to_string(i) + ".png";
-    auto const& image = images[i];
-    // XXX: I'm relying on color_t to serialize properly without
-    // intervention which may not be the case on non-x86 platforms
-    stbi_write_png(out_filename.c_str(), image.GetWidth(), image.GetHeight(),
-                   kImageComponents, image.GetData().data(),
-                   image.GetWidth() * kImageComponents);
+  auto const images = LoadSpriteArena(in_filename);
+
+  auto const encode_sprite = [&](size_t i) {
+    if (scale == 1) {
+      return EncodeImage(format, images[i], png_options);
+    }
+    Image scaled(images.GetWidth() * scale, images.GetHeight() * scale);
+    scaled.Blit(images[i], 0, 0, scale);
+    return EncodeImage(format, scaled, png_options);
+  };
+
+  // A prefix of "-" sends every image to stdout, one after the other
+  if (out_prefix == "-") {
+    for (size_t i = 0; i < images.size(); ++i) {
+      auto const data = encode_sprite(i);
+      std::cout.write(data.data(), data.size());
+    }
+    std::cout.flush();
+    if (!std::cout.good()) {
+      throw std::runtime_error("Failed to write to stdout");
+    }
+    return 0;
   }
 
+  // Sprites are encoded on the thread pool and written by a thread of its own,
+  // so encoding never waits for the disk. Encoded sprites wait in a bounded
+  // queue in case the disk can't keep up.
+  AsyncFileWriter writer(
+      static_cast<size_t>(std::max(1, flags.GetInt("queue-mb", 64))) << 20);
+  ParallelFor(0, images.size(), 1, [&](size_t i) {
+    writer.Write(out_prefix + std::to_string(i) +
+                     GetImageFormatExtension(format),
+                 encode_sprite(i));
+  });
+  writer.Finish();
+
   return 0;
 }
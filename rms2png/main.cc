@@ -1,119 +1,336 @@
+#include <explorer-utils/asset_cache.h>
 #include <explorer-utils/file.h>
+#include <explorer-utils/flags.h>
 #include <explorer-utils/image.h>
+#include <explorer-utils/image_sink.h>
 #include <explorer-utils/monster.h>
+#include <explorer-utils/png.h>
 #include <explorer-utils/room.h>
+#include <explorer-utils/room_render.h>
 #include <explorer-utils/spritesheet.h>
-#include <stb_image_write/stb_image_write.h>
+#include <explorer-utils/stats.h>
+#include <explorer-utils/thread_pool.h>
+#include <explorer-utils/threat.h>
 
+#include <algorithm>
+#include <cctype>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <sstream>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 namespace {
-constexpr auto kImageComponents = 3;  // RGB
+
+struct OutputOptions {
+  std::string prefix;
+  ImageFormat format = ImageFormat::png;
+  PngOptions png;
+  int scale = 1;
+  /// Every room is rendered once per variant
+  std::vector<std::string> variants = {"normal"};
+  /// Indexed by room_t::monster_id, only needed for kRenderQuasits
+  std::vector<bool> quasits;
+  /// Indexed by room_t::monster_id, only needed for kRenderThreat and
+  /// `threat_map`
+  std::vector<float> monster_threats;
+  /// Overview of the threat in every room, not written if empty
+  std::string threat_map;
+};
+
+// Each cell of the threat overview is a square this big (times the scale)
+constexpr auto kOverviewCellSize = 4;
+// Rooms per row of the threat overview
+constexpr auto kOverviewColumns = 8;
+constexpr auto kOverviewFloorColor = color_t{0x55, 0x55, 0x55};
+constexpr auto kOverviewThreatColor = color_t{0xFF, 0x00, 0x00};
+
+/// Marks every monster with "quasit" in its name, indexed by
+/// room_t::monster_id.
+std::vector<bool> FindQuasits(MonsterTable const& table) {
+  std::vector<bool> quasits(table.size() + 1);
+  for (auto i = 0; i < table.size(); ++i) {
+    auto name = table.names[i];
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    quasits[i + 1] = name.find("quasit") != std::string::npos;
+  }
+  return quasits;
+}
+
+/// Threat of every room. Also finds the most dangerous cell of the whole
+/// adventure, so that rooms can be shaded relative to it and compared.
+std::vector<ThreatMap> GetThreatMaps(std::vector<room_t> const& rooms,
+                                     std::vector<float> const& monster_threats,
+                                     float* max_threat) {
+  std::vector<ThreatMap> maps;
+  *max_threat = 0;
+  for (auto const& room : rooms) {
+    maps.push_back(GetThreatMap(room, monster_threats));
+    for (auto const threat : maps.back()) {
+      *max_threat = std::max(*max_threat, threat);
+    }
+  }
+  return maps;
+}
+
+/// Every room side by side, one square per cell, shaded by threat.
+void WriteThreatOverview(std::vector<room_t> const& rooms,
+                         OutputOptions const& output) {
+  auto max_threat = 0.0f;
+  auto const threat_maps =
+      GetThreatMaps(rooms, output.monster_threats, &max_threat);
+
+  // Rooms are separated by a cell's worth of black
+  auto const cell_size = kOverviewCellSize * output.scale;
+  auto const room_width = (kRoomWidth + 1) * cell_size;
+  auto const room_height = (kRoomHeight + 1) * cell_size;
+  auto const rows =
+      (static_cast<int>(rooms.size()) + kOverviewColumns - 1) /
+      kOverviewColumns;
+  Image overview(room_width * kOverviewColumns, room_height * rows);
+
+  for (auto i = 0; i < rooms.size(); ++i) {
+    auto const room_x = i % kOverviewColumns * room_width;
+    auto const room_y = i / kOverviewColumns * room_height;
+    for (auto cell = 0; cell < kRoomArea; ++cell) {
+      // Empty cells stay black
+      if (rooms[i].tiles[cell] == 0) {
+        continue;
+      }
+      auto const x = room_x + cell % kRoomWidth * cell_size;
+      auto const y = room_y + cell / kRoomWidth * cell_size;
+      overview.Blend(x, y, cell_size, cell_size, kOverviewFloorColor, 255);
+      if (max_threat > 0) {
+        auto const level = threat_maps[i][cell] / max_threat;
+        overview.Blend(x, y, cell_size, cell_size, kOverviewThreatColor,
+                       static_cast<uint8_t>(level * 255));
+      }
+    }
+  }
+  WriteImage(output.threat_map, output.format, overview, output.png);
+}
+
+/// Works with any spritesheet type that can be indexed for something
+/// blittable: LazySpritesheet, SpriteArena, SpriteArenaView. If `rooms` is
+/// null, rooms are read from stdin and each is rendered as soon as it has
+/// arrived.
+template <typename Spritesheet>
+void RenderRooms(Spritesheet const& tile_images,
+                 Spritesheet const& monster_images,
+                 Spritesheet const& monster_mask_images,
+                 std::vector<monster_t> const& monster_data,
+                 std::vector<room_t> const* rooms,
+                 OutputOptions const& output) {
+  std::vector<unsigned> modes;
+  auto any_threat = false;
+  for (auto const& variant : output.variants) {
+    modes.push_back(ParseRenderModes(variant));
+    any_threat |= (modes.back() & kRenderThreat) != 0;
+  }
+
+  // Without every room up front, the most dangerous cell isn't known, so
+  // shade relative to the most dangerous monster instead
+  auto max_threat = 0.0f;
+  if (any_threat && rooms) {
+    GetThreatMaps(*rooms, output.monster_threats, &max_threat);
+  } else if (any_threat) {
+    for (auto const threat : output.monster_threats) {
+      max_threat = std::max(max_threat, threat);
+    }
+  }
+
+  auto const render_room = [&](room_t const& room, int room_index) {
+    // A renderer per room, since rooms may be rendered in parallel and the
+    // threat map is per room
+    RoomRenderer<Spritesheet> renderer(tile_images, monster_images,
+                                       monster_mask_images, monster_data,
+                                       output.scale);
+    renderer.SetQuasits(output.quasits);
+    ThreatMap threat_map;
+    if (any_threat) {
+      threat_map = GetThreatMap(room, output.monster_threats);
+      renderer.SetThreatMap(&threat_map, max_threat);
+    }
+
+    std::vector<std::unique_ptr<ImageSink>> sinks;
+    for (auto const& variant : output.variants) {
+      // A prefix of "-" sends every room to stdout, one after the other
+      auto const suffix = variant == "normal" ? "" : "_" + variant;
+      auto const out_filename =
+          output.prefix == "-" ? output.prefix
+                               : output.prefix + std::to_string(room_index) +
+                                     suffix +
+                                     GetImageFormatExtension(output.format);
+      sinks.push_back(OpenImageSink(out_filename, output.format,
+                                    renderer.GetRoomWidth(),
+                                    renderer.GetRoomHeight(), output.png));
+    }
+
+    // Render and output one row of tiles at a time so that the full room
+    // image never exists in memory
+    Image strip(renderer.GetRoomWidth(), renderer.GetCellHeight());
+    for (auto y = 0; y < kRoomHeight; ++y) {
+      for (auto i = 0; i < sinks.size(); ++i) {
+        renderer.RenderRow(room, y, modes[i], strip);
+        sinks[i]->WriteRows(strip.GetData().data(), strip.GetHeight());
+      }
+    }
+    for (auto const& sink : sinks) {
+      sink->Finish();
+    }
+  };
+
+  if (!rooms) {
+    RoomReader reader(std::cin);
+    room_t room;
+    while (reader.Next(room)) {
+      render_room(room, reader.GetCount() - 1);
+    }
+    return;
+  }
+
+  // Rooms going to stdout have to stay in order, and LazySpritesheet decodes
+  // on first use so it can't be shared between threads
+  auto const render_nth_room = [&](size_t room_index) {
+    render_room((*rooms)[room_index], static_cast<int>(room_index));
+  };
+  if (output.prefix != "-" && !std::is_same_v<Spritesheet, LazySpritesheet>) {
+    ParallelFor(0, rooms->size(), 1, render_nth_room);
+  } else {
+    for (size_t room_index = 0; room_index < rooms->size(); ++room_index) {
+      render_nth_room(room_index);
+    }
+  }
+  if (!output.threat_map.empty()) {
+    WriteThreatOverview(*rooms, output);
+  }
+}
+
 }  // namespace
 
 int main(int argc, char** argv) {
-  if (argc < 7) {
+  Flags const flags(argc, argv, {"stats"});
+  auto const& args = flags.GetPositional();
+  if (args.size() < 6) {
     std::cerr << "Usage: " << argv[0]
-              << " egapics.pic pymon.pic pymask.pic pymon.dat in.rms prefix\n";
+              << " [--cache assets.cache] [--format png|ppm|qoi|rgb|indexed] "
+                 "[--level 0-9] [--scale N] [--modes normal,glass+traps,...] "
+                 "[--threat-map overview.png] egapics.pic pymon.pic "
+                 "pymask.pic pymon.dat in.rms prefix\n"
+                 "An in.rms of - reads rooms from stdin as they arrive\n"
+                 "Modes: normal, all, or any of glass, nodark, traps, soft, "
+                 "quasits, threat joined by +\n";
     return 1;
   }
 
-  auto const egapics_filename = argv[1];
-  auto const pymon_filename = argv[2];
-  auto const pymask_filename = argv[3];
-  auto const pymon_dat_filename = argv[4];
-  auto const rms_filename = argv[5];
-  auto const out_prefix = argv[6];
+  StatsReport const stats_report(flags);
+  SetThreadPoolSize(flags.GetInt("jobs", 0));
 
-  auto const tile_images = LoadSpritesheet(egapics_filename);
-  auto const monster_images = LoadSpritesheet(pymon_filename);
-  auto const monster_mask_images = LoadSpritesheet(pymask_filename);
-  auto const tile_width = tile_images[0].GetWidth();
-  auto const tile_height = tile_images[0].GetHeight();
+  auto const& egapics_filename = args[0];
+  auto const& pymon_filename = args[1];
+  auto const& pymask_filename = args[2];
+  auto const& pymon_dat_filename = args[3];
+  auto const& rms_filename = args[4];
+  auto const cache_filename = flags.Get("cache");
 
-  auto const rooms = LoadRooms(rms_filename);
-  auto const monster_data = LoadMonsterData(pymon_dat_filename);
+  OutputOptions output;
+  output.prefix = args[5];
+  output.format = ParseImageFormat(flags.Get("format", "png"));
+  output.png.level = flags.GetInt("level", output.png.level);
+  output.scale = std::max(1, flags.GetInt("scale", 1));
+  output.threat_map = flags.Get("threat-map");
+  auto any_quasits = false;
+  auto any_threat = !output.threat_map.empty();
+  if (flags.Has("modes")) {
+    output.variants.clear();
+    std::istringstream variants(flags.Get("modes"));
+    std::string variant;
+    while (std::getline(variants, variant, ',')) {
+      auto const modes = ParseRenderModes(variant);
+      any_quasits |= (modes & kRenderQuasits) != 0;
+      any_threat |= (modes & kRenderThreat) != 0;
+      output.variants.push_back(variant);
+    }
+  }
+  if (any_quasits || any_threat) {
+    auto const table = LoadMonsterTable(pymon_dat_filename);
+    if (any_quasits) {
+      output.quasits = FindQuasits(table);
+    }
+    if (any_threat) {
+      output.monster_threats = GetMonsterThreats(table);
+    }
+  }
+
+  // Streamed rooms are rendered as they arrive and never cached
+  auto const streaming = rms_filename == "-";
+  if (streaming && !output.threat_map.empty()) {
+    std::cerr << "--threat-map needs every room, so it can't be used when "
+                 "reading rooms from stdin\n";
+    return 1;
+  }
 
-  for (auto room_index = 0; room_index < rooms.size(); ++room_index) {
-    auto const& room = rooms[room_index];
-    Image map_image(tile_width * kRoomWidth, tile_height * kRoomHeight);
+  if (cache_filename.empty()) {
+    // Rooms only use a few of the available sprites, so decode on demand
+    auto const tile_images = LazySpritesheet(egapics_filename);
+    auto const monster_images = LazySpritesheet(pymon_filename);
+    auto const monster_mask_images = LazySpritesheet(pymask_filename);
+    auto const rooms =
+        streaming ? std::vector<room_t>() : LoadRooms(rms_filename);
+    RenderRooms(tile_images, monster_images, monster_mask_images,
+                LoadMonsterData(pymon_dat_filename),
+                streaming ? nullptr : &rooms, output);
+    return 0;
+  }
 
-    // TODO: Cheaters versions of the maps
-    // Make glass walls visible
-    // No magical darkness
-    // Highlight important traps
-    // Reveal soft walls and secret doors
-    // No fog
-    // Easier to see Quasits
+  auto const egapics_hash = HashSourceFile(egapics_filename);
+  auto const pymon_hash = HashSourceFile(pymon_filename);
+  auto const pymask_hash = HashSourceFile(pymask_filename);
+  auto const pymon_dat_hash = HashSourceFile(pymon_dat_filename);
+  auto const rms_hash = streaming ? 0 : HashSourceFile(rms_filename);
 
-    for (auto y = 0; y < kRoomHeight; ++y) {
-      for (auto x = 0; x < kRoomWidth; ++x) {
-        // FIRST do tile
-        auto tile = room.tiles[y * kRoomWidth + x];
-
-        // 0 is null, nothing here
-        if (tile == 0) {
-          continue;
-        }
-        tile -= 1;
-
-        // TODO: There are many kinds of traps (wands, XP) but they're stored as
-        // ASCII chars. Figure them out
-        if (tile >= tile_images.size()) {
-          tile = 20;
-        }
-
-        auto const& tile_img = tile_images[tile];
-        map_image.Blit(tile_img, x * tile_img.GetWidth(),
-                       y * tile_img.GetHeight());
-
-        // SECOND do object
-        auto object = room.objects[y * kRoomWidth + x];
-
-        // 0 is null, nothing here
-        if (object == 0) {
-          continue;
-        }
-
-        // Monsters (with mask)
-        if (object <= 'c') {
-          auto const monster_index = room.monster_id - 1;
-          auto const monster_gfx = monster_data[monster_index].gfx - 1;
-          auto const& monster_img = monster_images[monster_gfx];
-          auto const& mask_img = monster_mask_images[monster_gfx];
-          map_image.Blit(monster_img, mask_img, x * monster_img.GetWidth(),
-                         y * monster_img.GetHeight());
-          continue;
-        }
-
-        tile = GetObjectTile(object);
-        auto mask = GetObjectTileMask(object);
-
-        // Tiles no mask
-        if (mask == 0) {
-          auto const& obj_img = tile_images[tile];
-          map_image.Blit(obj_img, x * obj_img.GetWidth(),
-                         y * obj_img.GetHeight());
-          continue;
-        }
-
-        // Tiles with mask
-        auto const& obj_img = tile_images[tile];
-        auto const& mask_img = tile_images[mask];
-        map_image.Blit(obj_img, mask_img, x * obj_img.GetWidth(),
-                       y * obj_img.GetHeight());
-      }
+  auto const cache = AssetCache::Open(cache_filename);
+  if (cache) {
+    auto const tile_images = cache->FindSprites(egapics_hash);
+    auto const monster_images = cache->FindSprites(pymon_hash);
+    auto const monster_mask_images = cache->FindSprites(pymask_hash);
+    auto const monster_data = cache->FindMonsterData(pymon_dat_hash);
+    auto const rooms =
+        streaming ? std::nullopt : cache->FindRooms(rms_hash);
+    if (tile_images && monster_images && monster_mask_images && monster_data &&
+        (rooms || streaming)) {
+      RenderRooms(*tile_images, *monster_images, *monster_mask_images,
+                  *monster_data, rooms ? &*rooms : nullptr, output);
+      return 0;
     }
+  }
 
-    // XXX: I'm relying on color_t to serialize properly without
-    // intervention which may not be the case on non-x86 platforms
-    auto const out_filename = out_prefix + std::to_string(room_index) + ".png";
-    stbi_write_png(out_filename.c_str(), map_image.GetWidth(),
-                   map_image.GetHeight(), kImageComponents,
-                   map_image.GetData().data(),
-                   map_image.GetWidth() * kImageComponents);
+  // Cache is missing or stale: decode everything and rebuild it
+  auto const tile_images = LoadSpriteArena(egapics_filename);
+  auto const monster_images = LoadSpriteArena(pymon_filename);
+  auto const monster_mask_images = LoadSpriteArena(pymask_filename);
+  auto const monster_data = LoadMonsterData(pymon_dat_filename);
+  auto const rooms =
+      streaming ? std::vector<room_t>() : LoadRooms(rms_filename);
+
+  // A streaming run has no rooms to cache, so it leaves a usable cache alone
+  // rather than throw away the rooms some other run put there
+  if (!streaming || !cache) {
+    AssetCacheWriter writer;
+    writer.AddSprites(egapics_hash, tile_images);
+    writer.AddSprites(pymon_hash, monster_images);
+    writer.AddSprites(pymask_hash, monster_mask_images);
+    writer.AddMonsterData(pymon_dat_hash, monster_data);
+    if (!streaming) {
+      writer.AddRooms(rms_hash, rooms);
+    }
+    writer.Write(cache_filename);
   }
 
+  RenderRooms(tile_images, monster_images, monster_mask_images, monster_data,
+              streaming ? nullptr : &rooms, output);
   return 0;
 }
@@ -0,0 +1,161 @@
+#include <explorer-utils/adventure_solver.h>
+#include <explorer-utils/diagnostic.h>
+#include <explorer-utils/flags.h>
+#include <explorer-utils/monster.h>
+#include <explorer-utils/room.h>
+#include <explorer-utils/room_reach.h>
+#include <explorer-utils/spritesheet.h>
+#include <explorer-utils/stats.h>
+#include <explorer-utils/thread_pool.h>
+
+#include <array>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr std::array<char const*, kNumRoomExits> kExitNames = {
+    "north", "east", "south", "west", "up", "down", "teleport"};
+
+std::string FormatExits(uint8_t exits) {
+  std::string text;
+  for (auto exit = 0; exit < kNumRoomExits; ++exit) {
+    if ((exits >> exit & 1) == 0) {
+      continue;
+    }
+    if (!text.empty()) {
+      text += ',';
+    }
+    text += kExitNames[exit];
+  }
+  return text.empty() ? "-" : text;
+}
+
+/// Whole-adventure check: which rooms can be reached from the start room.
+/// Returns the exit code.
+int Solve(std::vector<room_t> const& rooms, int start_room, int goal_room,
+          solver_options_t const& options) {
+  auto const result = SolveAdventure(rooms, start_room, options);
+
+  auto num_reachable = 0;
+  for (auto i = 0; i < rooms.size(); ++i) {
+    num_reachable += result.reachable[i];
+  }
+  std::cout << num_reachable << " of " << rooms.size()
+            << " rooms reachable from room " << start_room << '\n';
+  if (result.incomplete) {
+    std::cout << "Some rooms have too many block positions to search, so "
+                 "this may be an underestimate\n";
+  }
+  std::cout << "unreachable:";
+  for (auto i = 0; i < rooms.size(); ++i) {
+    if (!result.reachable[i]) {
+      std::cout << ' ' << i;
+    }
+  }
+  std::cout << '\n';
+
+  if (goal_room < 0) {
+    return 0;
+  }
+  if (goal_room >= rooms.size() || !result.reachable[goal_room]) {
+    std::cout << "goal room " << goal_room << " can't be reached\n";
+    return 2;
+  }
+  // Walk back from the goal to print the route forwards
+  std::vector<int> route;
+  for (auto room = goal_room; room >= 0; room = result.previous[room]) {
+    route.push_back(room);
+  }
+  std::cout << "route to goal:";
+  for (auto it = route.rbegin(); it != route.rend(); ++it) {
+    std::cout << ' ' << *it;
+  }
+  std::cout << '\n';
+  return 0;
+}
+
+/// Checks every file for problems that would break the other tools. Returns
+/// the exit code.
+int Validate(std::vector<std::string> const& rms_filenames,
+             std::string const& pymon_pic_filename,
+             std::string const& pymon_dat_filename) {
+  Diagnostics diagnostics;
+  size_t num_sprites = 0;
+  if (!pymon_pic_filename.empty()) {
+    num_sprites = LoadSpriteArena(pymon_pic_filename, diagnostics).size();
+  }
+  size_t num_monsters = 0;
+  if (!pymon_dat_filename.empty()) {
+    num_monsters =
+        LoadMonsterData(pymon_dat_filename, diagnostics, num_sprites).size();
+  }
+  for (auto const& filename : rms_filenames) {
+    LoadRooms(filename, diagnostics, num_monsters);
+  }
+
+  for (auto const& diagnostic : diagnostics) {
+    std::cout << FormatDiagnostic(diagnostic) << '\n';
+  }
+  return diagnostics.empty() ? 0 : 2;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Flags const flags(argc, argv, {"locked-doors", "solid-soft-walls",
+                                 "pass-blocks", "solve", "validate", "stats"});
+  auto const& args = flags.GetPositional();
+  if (args.empty()) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--locked-doors] [--solid-soft-walls] [--pass-blocks] "
+                 "[--solve [--start N] [--goal N] [--jobs N]] in.rms\n"
+              << "       " << argv[0]
+              << " --validate [--pymon-pic pymon.pic] [--pymon-dat pymon.dat] "
+                 "in.rms...\n"
+              << "For every room and every way in, prints the exits that can "
+                 "be reached.\n"
+              << "With --solve, prints which rooms can be reached from the "
+                 "start room instead, pushing blocks as needed.\n"
+              << "With --validate, prints every problem found in the files "
+                 "instead.\n";
+    return 1;
+  }
+
+  StatsReport const stats_report(flags);
+  SetThreadPoolSize(flags.GetInt("jobs", 0));
+
+  if (flags.Has("validate")) {
+    return Validate(args, flags.Get("pymon-pic", ""),
+                    flags.Get("pymon-dat", ""));
+  }
+
+  reach_options_t options;
+  options.open_doors = !flags.Has("locked-doors");
+  options.break_soft_walls = !flags.Has("solid-soft-walls");
+  options.pass_blocks = flags.Has("pass-blocks");
+
+  auto const rooms = LoadRooms(args[0]);
+  if (flags.Has("solve")) {
+    solver_options_t solver_options;
+    solver_options.reach = options;
+    return Solve(rooms, flags.GetInt("start", 0), flags.GetInt("goal", -1),
+                 solver_options);
+  }
+
+  std::cout << "room\tfrom\tto\n";
+  for (auto i = 0; i < rooms.size(); ++i) {
+    auto const reach = GetRoomReach(rooms[i], options);
+    for (auto from = 0; from < kNumRoomExits; ++from) {
+      // The teleport only goes one way
+      if (from == kExitTeleport ||
+          !HasExit(rooms[i], static_cast<RoomExit>(from))) {
+        continue;
+      }
+      std::cout << i << '\t' << kExitNames[from] << '\t'
+                << FormatExits(reach.exits[from]) << '\n';
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include <explorer-utils/flags.h>
+#include <explorer-utils/room.h>
+#include <explorer-utils/room_similarity.h>
+#include <explorer-utils/stats.h>
+#include <explorer-utils/thread_pool.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+/// Prints a cell value as a character when it's a letter, as a number
+/// otherwise.
+std::string FormatObject(uint8_t object) {
+  if (object >= 'a' && object <= 'z') {
+    return std::string(1, static_cast<char>(object));
+  }
+  return std::to_string(object);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Flags const flags(argc, argv, {"no-diff", "stats"});
+  auto const& args = flags.GetPositional();
+  if (args.empty()) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--threshold 0.0-1.0] [--no-diff] in.rms...\n"
+              << "Finds rooms, across every file, whose tiles and objects are "
+                 "nearly the same.\n";
+    return 1;
+  }
+
+  StatsReport const stats_report(flags);
+  SetThreadPoolSize(flags.GetInt("jobs", 0));
+
+  auto const threshold = std::stod(flags.Get("threshold", "0.9"));
+
+  // Search every file at once, remembering where each room came from
+  std::vector<room_t> rooms;
+  std::vector<std::pair<int, int>> origins;
+  for (auto file = 0; file < args.size(); ++file) {
+    auto const file_rooms = LoadRooms(args[file]);
+    for (auto i = 0; i < file_rooms.size(); ++i) {
+      rooms.push_back(file_rooms[i]);
+      origins.emplace_back(file, i);
+    }
+  }
+
+  for (auto const& match : FindSimilarRooms(rooms, threshold)) {
+    auto const& [file_a, room_a] = origins[match.a];
+    auto const& [file_b, room_b] = origins[match.b];
+    std::cout << args[file_a] << '\t' << room_a << '\t' << args[file_b]
+              << '\t' << room_b << '\t' << match.similarity << '\n';
+    if (flags.Has("no-diff")) {
+      continue;
+    }
+    for (auto const& diff : DiffRooms(rooms[match.a], rooms[match.b])) {
+      std::cout << "  (" << +diff.x << ", " << +diff.y << ")";
+      if (diff.tile_a != diff.tile_b) {
+        std::cout << " tile " << +diff.tile_a << " -> " << +diff.tile_b;
+      }
+      if (diff.object_a != diff.object_b) {
+        std::cout << " object " << FormatObject(diff.object_a) << " -> "
+                  << FormatObject(diff.object_b);
+      }
+      std::cout << '\n';
+    }
+  }
+  return 0;
+}
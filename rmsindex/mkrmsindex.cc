@@ -0,0 +1,40 @@
+#include <explorer-utils/flags.h>
+#include <explorer-utils/room.h>
+#include <explorer-utils/room_index.h>
+#include <explorer-utils/stats.h>
+#include <explorer-utils/thread_pool.h>
+
+#include <iostream>
+
+int main(int argc, char** argv) {
+  Flags const flags(argc, argv, {"stats"});
+  auto const& args = flags.GetPositional();
+  if (args.size() < 2) {
+    std::cerr << "Usage: " << argv[0] << " out.idx in.rms...\n";
+    return 1;
+  }
+
+  StatsReport const stats_report(flags);
+  SetThreadPoolSize(flags.GetInt("jobs", 0));
+
+  // Community files can be broken in all sorts of ways. Most problems only
+  // affect a room or two, so those files are still indexed; files that can't
+  // be used as a whole are left out rather than index garbage.
+  RoomIndexWriter writer;
+  for (auto i = 1; i < args.size(); ++i) {
+    Diagnostics diagnostics;
+    auto const rooms = LoadRooms(args[i], diagnostics);
+    auto fatal = false;
+    for (auto const& diagnostic : diagnostics) {
+      std::cerr << FormatDiagnostic(diagnostic) << '\n';
+      fatal |= diagnostic.fatal;
+    }
+    if (fatal) {
+      std::cerr << "Skipping " << args[i] << '\n';
+      continue;
+    }
+    writer.AddFile(args[i], rooms);
+  }
+  writer.Write(args[0]);
+  return 0;
+}
@@ -0,0 +1,136 @@
+#include <explorer-utils/flags.h>
+#include <explorer-utils/room_index.h>
+#include <explorer-utils/stats.h>
+#include <explorer-utils/thread_pool.h>
+
+#include <cctype>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std::string_literals;
+
+namespace {
+
+/// Tiles and monsters are numbers. Objects are either a letter or a number.
+/// Throws std::invalid_argument for anything else.
+uint32_t ParseValue(std::string const& text, bool allow_char) {
+  if (allow_char && text.size() == 1 && !std::isdigit(text[0])) {
+    return static_cast<unsigned char>(text[0]);
+  }
+  size_t parsed = 0;
+  unsigned long value = 0;
+  if (!text.empty() && std::isdigit(text[0])) {
+    try {
+      value = std::stoul(text, &parsed);
+    } catch (std::out_of_range const&) {
+      parsed = 0;
+    }
+  }
+  if (parsed == 0 || parsed != text.size() || value > UINT32_MAX) {
+    throw std::invalid_argument("Not a number: "s + text);
+  }
+  return static_cast<uint32_t>(value);
+}
+
+/// Rooms matching one query term, see the usage message for the syntax.
+std::vector<uint32_t> FindTerm(RoomIndex const& index,
+                               std::string const& term) {
+  auto const colon = term.find(':');
+  if (colon == std::string::npos) {
+    throw std::invalid_argument("Query terms look like kind:value: "s + term);
+  }
+  auto const kind = term.substr(0, colon);
+  auto value = term.substr(colon + 1);
+
+  auto const find = [&](IndexTerm index_term, uint32_t index_value) {
+    auto const postings = index.Find(index_term, index_value);
+    return std::vector<uint32_t>(postings.begin(), postings.end());
+  };
+
+  if (kind == "tile") {
+    return find(IndexTerm::tile, ParseValue(value, false));
+  }
+  if (kind == "object") {
+    return find(IndexTerm::object, ParseValue(value, true));
+  }
+  if (kind == "monster") {
+    return find(IndexTerm::monster, ParseValue(value, false));
+  }
+  if (kind == "near") {
+    auto const second_colon = value.find(':');
+    if (second_colon == std::string::npos) {
+      throw std::invalid_argument("Expected near:tile:object: "s + term);
+    }
+    auto const tile = ParseValue(value.substr(0, second_colon), false);
+    auto const object = ParseValue(value.substr(second_colon + 1), true);
+    return find(IndexTerm::adjacent, MakeAdjacentTerm(tile, object));
+  }
+  if (kind == "name") {
+    // Always a substring match, so wildcards at the ends are redundant
+    while (!value.empty() && value.front() == '*') {
+      value.erase(value.begin());
+    }
+    while (!value.empty() && value.back() == '*') {
+      value.pop_back();
+    }
+    return index.FindName(value);
+  }
+  throw std::invalid_argument("Unknown query term: "s + kind);
+}
+
+void PrintUsage(char const* program) {
+  std::cerr << "Usage: " << program << " index.idx term...\n"
+            << "Prints the rooms matching every term, one per line: file, "
+               "room number and name.\n"
+            << "Terms:\n"
+            << "  tile:N         uses tile N (raw RMS value)\n"
+            << "  object:X       has object X (letter or number)\n"
+            << "  monster:N      has monster N (PYMON.DAT record, 1-based)\n"
+            << "  near:N:X       has object X next to tile N\n"
+            << "  name:text      name contains text, ignoring case\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Flags const flags(argc, argv, {"stats"});
+  auto const& args = flags.GetPositional();
+  if (args.size() < 2) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  StatsReport const stats_report(flags);
+  SetThreadPoolSize(flags.GetInt("jobs", 0));
+
+  auto const index = RoomIndex::Open(args[0]);
+  if (!index) {
+    std::cerr << "Not a valid index: " << args[0] << '\n';
+    return 1;
+  }
+
+  std::vector<uint32_t> matches;
+  try {
+    matches = FindTerm(*index, args[1]);
+    for (auto i = 2; i < args.size() && !matches.empty(); ++i) {
+      auto const next = FindTerm(*index, args[i]);
+      matches = IntersectPostings(
+          matches, RoomIndex::PostingList{next.data(), next.size()});
+    }
+  } catch (std::invalid_argument const& error) {
+    // A malformed term
+    std::cerr << error.what() << '\n';
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  for (auto const global_room : matches) {
+    auto const room = index->GetRoom(global_room);
+    std::cout << index->GetFilename(room.file) << '\t' << room.room << '\t'
+              << index->GetRoomName(global_room) << '\n';
+  }
+  return 0;
+}
@@ -0,0 +1,156 @@
+#include <explorer-utils/adventure_store.h>
+#include <explorer-utils/flags.h>
+#include <explorer-utils/histogram.h>
+#include <explorer-utils/object.h>
+#include <explorer-utils/stats.h>
+#include <explorer-utils/thread_pool.h>
+#include <explorer-utils/trap.h>
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+using namespace std::string_literals;
+
+namespace {
+
+/// Coded traps are told apart by a character in editors, but codes past '~'
+/// aren't printable, so those are shown as the number.
+std::string FormatTrapCode(uint8_t code) {
+  if (code >= ' ' && code <= '~') {
+    return "'"s + static_cast<char>(code) + "'";
+  }
+  return std::to_string(code);
+}
+
+void PrintTiles(Histogram const& histogram) {
+  std::cout << "tile\tcount\n";
+  for (auto tile = 1; tile < 256; ++tile) {
+    if (histogram[tile] == 0) {
+      continue;
+    }
+    std::cout << tile << '\t' << histogram[tile];
+    auto const& trap = GetTrapInfo(tile);
+    if (trap.kind == trap_kind::coded) {
+      std::cout << "\ttrap " << FormatTrapCode(trap.code);
+    }
+    std::cout << '\n';
+  }
+}
+
+void PrintObjects(Histogram const& histogram) {
+  std::cout << "object\tcount\n";
+  for (auto object = 1; object < 256; ++object) {
+    if (histogram[object] == 0) {
+      continue;
+    }
+    auto const& info = GetObjectInfo(object);
+    std::cout << static_cast<char>(object) << '\t' << histogram[object];
+    if (info.name) {
+      std::cout << '\t' << info.name;
+    }
+    std::cout << '\n';
+  }
+}
+
+/// Cells and rooms holding each kind of trap, indexed by trap_info_t::id.
+struct trap_totals_t {
+  std::array<uint32_t, kNumTrapIds> cells{};
+  std::array<uint32_t, kNumTrapIds> rooms{};
+  uint32_t rooms_with_traps = 0;
+};
+
+void AddTraps(AdventureStore const& store, trap_totals_t& totals) {
+  for (size_t i = 0; i < store.size(); ++i) {
+    std::array<uint32_t, kNumTrapIds> counts{};
+    CountTraps(store.GetTiles(i), counts);
+    auto any = false;
+    // Id 0 counts the cells that aren't traps
+    for (auto id = 1; id < kNumTrapIds; ++id) {
+      totals.cells[id] += counts[id];
+      totals.rooms[id] += counts[id] != 0;
+      any |= counts[id] != 0;
+    }
+    totals.rooms_with_traps += any;
+  }
+}
+
+void PrintTraps(trap_totals_t const& totals) {
+  std::cout << "trap\tcells\trooms\n";
+  for (auto tile = 0; tile < 256; ++tile) {
+    if (!IsTrap(tile)) {
+      continue;
+    }
+    auto const& trap = GetTrapInfo(tile);
+    if (totals.cells[trap.id] == 0) {
+      continue;
+    }
+    if (trap.kind == trap_kind::coded) {
+      std::cout << FormatTrapCode(trap.code);
+    } else {
+      std::cout << "plain";
+    }
+    std::cout << '\t' << totals.cells[trap.id] << '\t'
+              << totals.rooms[trap.id] << '\n';
+  }
+  std::cout << "rooms with traps\t" << totals.rooms_with_traps << '\n';
+}
+
+/// Real tiles and known objects that never appear.
+void PrintUnused(Histogram const& tiles, Histogram const& objects) {
+  std::cout << "unused tiles:";
+  for (auto tile = 1; tile <= kMaxTile; ++tile) {
+    if (tiles[tile] == 0) {
+      std::cout << ' ' << tile;
+    }
+  }
+  std::cout << "\nunused objects:";
+  for (auto object = 'd'; object <= 'w'; ++object) {
+    if (objects[object] == 0) {
+      std::cout << ' ' << object;
+    }
+  }
+  std::cout << '\n';
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Flags const flags(argc, argv, {"unused", "traps", "stats"});
+  auto const& args = flags.GetPositional();
+  if (args.empty()) {
+    std::cerr << "Usage: " << argv[0] << " [--unused] [--traps] in.rms...\n"
+              << "Prints how many times each tile and object appears across "
+                 "every room of every file.\n";
+    return 1;
+  }
+
+  StatsReport const stats_report(flags);
+  SetThreadPoolSize(flags.GetInt("jobs", 0));
+
+  Histogram tiles{};
+  Histogram objects{};
+  trap_totals_t traps;
+  for (auto const& filename : args) {
+    auto const store = LoadAdventureStore(filename);
+    AddToHistogram(store.tiles.data(), store.tiles.size(), tiles);
+    AddToHistogram(store.objects.data(), store.objects.size(), objects);
+    if (flags.Has("traps")) {
+      AddTraps(store, traps);
+    }
+  }
+
+  PrintTiles(tiles);
+  std::cout << '\n';
+  PrintObjects(objects);
+  if (flags.Has("unused")) {
+    std::cout << '\n';
+    PrintUnused(tiles, objects);
+  }
+  if (flags.Has("traps")) {
+    std::cout << '\n';
+    PrintTraps(traps);
+  }
+  return 0;
+}